@@ -21,9 +21,11 @@
 
 #include "NDataLink.h"
 #include "NSerialProtocol.h"
+#include "BusUart.h"
 
 //------------------------------------------------------------------------------
-#define BUS_PORT		USART1, seStandard
+#define BUS_PORT		USART1, seStandard	// NSerial (BUS_NSERIAL builds only)
+#define BUS_BAUD		9600				// BusUart: NSerial's standard rate
 #define BLE_PORT		USART2, seStandard
 #define MEM_PORT		I2C1
 #define TIMEBASE		TIM2
@@ -37,9 +39,19 @@
 #define ADDR3			GPIOA, (uint32_t)6
 #define ADDR4			GPIOA, (uint32_t)7
 
+#define CURRENT_SENSE	adCH0		// PA0: servo supply current (shunt amplifier)
+
 #define USART1_CTS		GPIOA,  (uint32_t)11
 #define USART1_RTS		GPIOA,  (uint32_t)12
 
+// RS-485 transceiver: RE (PA11) and DE (PA12) switched together, in one write
+#define BUS_DIR_PORT	GPIOA
+#define BUS_DIR_MASK	((uint32_t)((0x01 << 11) | (0x01 << 12)))
+
+// interrupt priorities: PPM timebase first (pulse width jitter), bus second
+#define IRQ_PRIORITY_PPM	htPriorityLevel0
+#define IRQ_PRIORITY_BUS	1
+
 #define SEGMENT_A		GPIOB, (uint32_t)0
 #define SEGMENT_B		GPIOB, (uint32_t)1
 #define SEGMENT_C		GPIOB, (uint32_t)2
@@ -49,6 +61,10 @@
 #define SEGMENT_G		GPIOB, (uint32_t)6
 #define SEGMENT_H		GPIOB, (uint32_t)7
 
+// the same segment lines, as seen by FlipDisplayFixed (A..H on consecutive pins)
+#define SEGMENT_PORT	GPIOB_BASE
+#define SEGMENT_PIN0	0
+
 #define DRV_VR			GPIOB, (uint32_t)12
 #define DRV_HR			GPIOC, (uint32_t)14
 
@@ -57,6 +73,82 @@
 #define FSM_GETSTATUS	1
 #define FSM_SETDATA		2
 
+//------------------------------------------------------------------------------
+// PROSA commands specific to the digit controller (DGT-02)
+#define PROSA_CMD_SETMESSAGE	((uint8_t) 0x40)
+#define PROSA_CMD_UPDATE_BEGIN	((uint8_t) 0x41)
+#define PROSA_CMD_UPDATE_BLOCK	((uint8_t) 0x42)
+#define PROSA_CMD_UPDATE_STATUS	((uint8_t) 0x43)
+#define PROSA_CMD_UPDATE_APPLY	((uint8_t) 0x44)
+#define PROSA_CMD_SETBAUD		((uint8_t) 0x45)
+#define PROSA_CMD_CONFIRMBAUD	((uint8_t) 0x46)
+#define PROSA_CMD_DISCOVER		((uint8_t) 0x47)
+#define PROSA_CMD_BENCHMARK		((uint8_t) 0x48)
+#define PROSA_CMD_SIGNATURE		((uint8_t) 0x49)
+#define PROSA_CMD_STANDBY		((uint8_t) 0x4A)
+#define PROSA_CMD_PROFILE		((uint8_t) 0x4B)
+#define PROSA_CMD_SCOREEVENT	((uint8_t) 0x4C)
+#define PROSA_CMD_SCORESUM		((uint8_t) 0x4D)
+#define PROSA_CMD_MEMORY		((uint8_t) 0x4E)
+
+#define BUS_CMD_SLOTS			0x50	// command table size (highest ID + 1)
+
+//------------------------------------------------------------------------------
+// bus timing at the standard rate (ms); divided by the negotiated rate factor
+#define BUS_TIME_RELOAD			100
+#define BUS_TIME_DISPATCH		40
+#define BUS_TIMEOUT				25
+#define BUS_TIME_MIN			2
+
+#define BAUD_FACTOR_MAX			8		// 1, 2, 4 or 8 times the standard rate
+#define BAUD_REPLY_BYTES		8		// SETBAUD reply: header (4) + answer (2) + crc (2)
+#define BAUD_SWITCH_GUARD		5		// ms after the SETBAUD reply, see BaudSwitchDelay()
+#define BAUD_CONFIRM_TIMEOUT	1000	// ms, to receive CONFIRMBAUD at the new rate
+#define BAUD_LINK_TIMEOUT		5000	// ms, bus silence before falling back
+
+//------------------------------------------------------------------------------
+// The slot actually used is DiscoverSlot(): reply airtime + dispatch + 1 ms.
+// At 9600 baud that is ~16 + 40 + 1 = 57ms, so a full scan takes
+// DISCOVER_GUARD + (BUS_NODES + 1) * 57 = ~630ms; at 8x, 2 + 5 + 1 = 8ms
+// and ~90ms.
+#define DISCOVER_SLOT			5		// ms, floor for the per-node slot
+#define DISCOVER_GUARD			2		// ms before the first slot
+#define DISCOVER_REPLY_BYTES	15		// header (4) + answer (9) + crc (2)
+
+//------------------------------------------------------------------------------
+#define UPDATE_ERASE_TIME		1500	// ms, controller wait after UPDATE_BEGIN
+#define UPDATE_APPLY_DELAY		100		// ms, lets the UPDATE_APPLY reply go out
+
+//------------------------------------------------------------------------------
+// the capture is spread over the phase (see Digit_OnMoveStart()): clear
+// 100ms, H 200ms, V 400ms, arrow 500ms at the default travel, plus ramps
+#define SIGNATURE_SAMPLES		64		// current samples per move (one DMA block)
+#define SIGNATURE_COVER			7		// eighths of the phase captured
+#define SIGNATURE_INTERVAL_MIN	1500	// us, shortest NAdc sampling interval
+
+//------------------------------------------------------------------------------
+#define CONFIG_MAGIC			((uint32_t) 0x50524633)	// "PRF3": profile, ramps, baselines
+#define RAMP_DEFAULT			3		// PPM frames per move phase (60ms at 20ms)
+
+//------------------------------------------------------------------------------
+#define SCORE_SEQ_NONE			0xFF	// no SCOREEVENT taken since reset
+
+//------------------------------------------------------------------------------
+#define STANDBY_IDLE_TIME		600000	// ms without display commands before standby
+#define STANDBY_ENTER_DELAY		50		// ms, lets pending replies go out first
+#define STANDBY_RETRY			1000	// ms, while the digit is moving or updating
+#define STANDBY_WAKE_TIME		5		// ms, controller wait after the wake preamble
+#define STANDBY_HSE_TIMEOUT		0x5000	// HSERDY polls (~10ms on HSI) before giving up
+
+//------------------------------------------------------------------------------
+// power-on calibration waves: nodes calibrate in groups of BOOT_WAVE_NODES,
+// by LocalIndex, so that no more than BOOT_SERVO_BUDGET servos start at once
+#define BOOT_SERVO_BUDGET		8		// servos the board supply can start together
+#define BOOT_LOAD_NODE			4		// servos on one driver line (clear, H or V phase)
+#define BOOT_WAVE_NODES			(BOOT_SERVO_BUDGET / BOOT_LOAD_NODE)
+#define BOOT_WAVE_TIME			2000	// ms, longer than a full calibration move (ramps included)
+#define BOOT_POLL				20		// ms, end of calibration check
+
 //------------------------------------------------------------------------------
 #define BUS_NODES		10
 #define PLAY1_TENS		((uint8_t) 0x01)
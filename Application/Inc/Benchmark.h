@@ -0,0 +1,89 @@
+//==============================================================================
+/**
+ * @file Benchmark.h
+ * @brief Cycle counting probes for time critical handlers\n
+ * Measures, with the Cortex-M3 DWT cycle counter, the cost of each call of
+ * the instrumented handlers (min / avg / max) and their share of the CPU
+ * (load). A probe with a window (BENCH_OPEN / BENCH_CLOSE) gets its load
+ * over the time the window was open only; the others over the whole time
+ * since the last reset.
+ * @version 1.0.0
+ *
+ *------------------------------------------------------------------------------
+ *
+ * This software component is licensed under BSD 3-Clause license, the
+ * "License". You may not use this file except in compliance with the License.
+ *               You may obtain a copy of the License at:
+ *                 opensource.org/licenses/BSD-3-Clause
+ *
+ *///------------------------------------------------------------------------------
+#ifndef Benchmark_H
+    #define Benchmark_H
+
+	#include <stdint.h>
+	#include "stm32f1xx.h"
+
+	//-----------------------------------
+	// Defined by the "Benchmark" build configuration (.cproject). Without it,
+	// the BENCH_* macros compile to nothing.
+	//#define BENCHMARK_ENABLED
+
+	#define BENCH_PPM_TICK		0		// FlipDisplay::ProcessEvent(), window: digit moving
+	#define BENCH_BUS_PACKET	1		// BusPort_OnPacket() (link + command)
+	#define BENCH_PROBES		2
+
+    //-----------------------------------
+	/** @brief Statistics of one probe, in CPU cycles.
+	 */
+	struct BenchProbe{
+		uint32_t min;
+		uint32_t max;
+		uint32_t sum;
+		uint32_t count;
+		uint32_t start;
+		uint32_t window;	// cycles the window was open (closed periods)
+		uint32_t opened;	// cycle count when the window opened
+		bool open;
+		bool windowed;		// opened at least once since the last reset
+	};
+
+	extern BenchProbe BenchProbes[BENCH_PROBES];
+	extern uint32_t BenchWindow;
+
+	/**
+	 * @brief Enables the DWT cycle counter and clears every probe.
+	 */
+	void BenchReset();
+
+	/**
+	 * @brief Fills "result" with | min | avg | max | count | load (per mille) |
+	 * of one probe (load is the probe share of the cycles its window was open
+	 * or, for a probe without a window, of all cycles since BenchReset()).
+	 */
+	void BenchRead(uint8_t, uint32_t*);
+
+	/**
+	 * @brief Opens / closes the load window of one probe.
+	 */
+	void BenchOpen(uint8_t);
+	void BenchClose(uint8_t);
+
+	#ifdef BENCHMARK_ENABLED
+		#define BENCH_BEGIN(p)	BenchProbes[p].start = DWT->CYCCNT
+		#define BENCH_END(p)	do{ \
+			uint32_t bench_cycles = DWT->CYCCNT - BenchProbes[p].start; \
+			if(bench_cycles < BenchProbes[p].min){ BenchProbes[p].min = bench_cycles;} \
+			if(bench_cycles > BenchProbes[p].max){ BenchProbes[p].max = bench_cycles;} \
+			BenchProbes[p].sum += bench_cycles; BenchProbes[p].count++; \
+		} while(0)
+		#define BENCH_OPEN(p)	BenchOpen(p)
+		#define BENCH_CLOSE(p)	BenchClose(p)
+	#else
+		#define BENCH_BEGIN(p)
+		#define BENCH_END(p)
+		#define BENCH_OPEN(p)
+		#define BENCH_CLOSE(p)
+	#endif
+
+#endif
+//==============================================================================
@@ -0,0 +1,87 @@
+//==============================================================================
+/**
+ * @file BlockMap.h
+ * @brief Received blocks bitmap class\n
+ * This class keeps track of which blocks of a transfer have arrived (one bit
+ * per block) and reports the missing ones, as a count, as the first missing
+ * index or as a window of the bitmap. Pure logic, no hardware access.
+ * @version 1.0.0
+ *
+ *------------------------------------------------------------------------------
+ *
+ * This software component is licensed under BSD 3-Clause license, the
+ * "License". You may not use this file except in compliance with the License.
+ *               You may obtain a copy of the License at:
+ *                 opensource.org/licenses/BSD-3-Clause
+ *
+ *///------------------------------------------------------------------------------
+#ifndef BlockMap_H
+    #define BlockMap_H
+
+	#include <stdint.h>
+
+	#define BLOCKMAP_BLOCKS_MAX		1024
+	#define BLOCKMAP_SIZE			(BLOCKMAP_BLOCKS_MAX / 8)
+
+    //-----------------------------------
+    /** @brief Received blocks bitmap
+     */
+    class BlockMap{
+
+        private:
+            uint8_t received[BLOCKMAP_SIZE];
+            uint16_t blocks;
+            uint16_t missing;
+
+        public:
+            //-------------------------------------------
+            // METHODS
+            /**
+             * @brief Constructor for this component (empty transfer).
+             */
+            BlockMap();
+
+            /**
+             * @brief Starts a new transfer of "blocks" blocks, none received.
+             * @return false (map empty) if "blocks" exceeds BLOCKMAP_BLOCKS_MAX.
+             */
+            bool Reset(uint16_t);
+
+            /**
+             * @brief Marks block "index" as received (duplicates are ignored).
+             * @return false if the block is out of range.
+             */
+            bool Set(uint16_t);
+
+            /**
+             * @brief true if block "index" was received.
+             */
+            bool Has(uint16_t);
+
+            /**
+             * @brief Copies "size" bytes of the missing blocks bitmap (1 = missing),
+             * starting at byte "offset", into "buffer". Bits beyond the last
+             * block read as received.
+             */
+            void Missing(uint8_t*, uint8_t, uint8_t);
+
+            /**
+             * @brief Index of the first missing block (or number of blocks if none).
+             */
+            uint16_t FirstMissing();
+
+            //---------------------------------------
+            // PROPERTIES
+            /**
+             * @brief Number of blocks in the transfer.
+             */
+            uint16_t Blocks(){ return(blocks);}
+
+            /**
+             * @brief Number of blocks still missing.
+             */
+            uint16_t Pending(){ return(missing);}
+    };
+
+#endif
+//==============================================================================
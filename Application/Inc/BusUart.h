@@ -0,0 +1,131 @@
+//==============================================================================
+/**
+ * @file BusUart.h
+ * @brief RS-485 bus port on USART1 with DMA\n
+ * Receives into a circular DMA ring (DMA1 channel 5) and ends a frame on the
+ * USART idle line; transmits with DMA1 channel 4 and releases the transceiver
+ * only after the last stop bit has left the shift register (DMA transfer
+ * complete, then USART transmission complete). Received frames are handed to
+ * OnPacket on the next NM_TIMETICK, never from the interrupts.
+ * @version 1.0.0
+ *
+ *------------------------------------------------------------------------------
+ *
+ * This software component is licensed under BSD 3-Clause license, the
+ * "License". You may not use this file except in compliance with the License.
+ *               You may obtain a copy of the License at:
+ *                 opensource.org/licenses/BSD-3-Clause
+ *
+ *///------------------------------------------------------------------------------
+#ifndef BusUart_H
+    #define BusUart_H
+
+	#include <stdint.h>
+	#include "stm32f1xx.h"
+	#include "NComponent.h"
+
+	//-----------------------------------
+	// This file defines USART1_IRQHandler and DMA1_Channel4_IRQHandler. If the
+	// framework's NSerial is linked for USART1 as well, its handlers clash with
+	// these (duplicate symbols at link time): define BUS_NSERIAL in the project
+	// settings to keep the bus on NSerial, and BusUart compiles to nothing.
+	//#define BUS_NSERIAL
+
+	#define BUS_RX_RING			256		// receive ring (power of 2): ~270ms at 9600 baud
+	#define BUS_FRAME_MAX		64		// longest frame (UPDATE_BLOCK: 4 + 34 + 2)
+	#define BUS_FRAMES_QUEUED	4		// frames ended, not handed over yet
+
+    //-----------------------------------
+    /** @brief USART1 + DMA bus port (PA9 Tx, PA10 Rx)\n
+     * The caller switches the RS-485 transceiver in OnEnterTransmission and
+     * OnLeaveTransmission. A frame is whatever arrives between two idle lines;
+     * frames longer than BUS_FRAME_MAX, or ended while BUS_FRAMES_QUEUED are
+     * still waiting, are dropped (see Dropped).
+     */
+    class BusUart : public NComponent{
+
+        private:
+            uint8_t ring[BUS_RX_RING];
+            uint8_t frame[BUS_FRAME_MAX];
+            uint8_t tx[BUS_FRAME_MAX];
+            volatile uint16_t ends[BUS_FRAMES_QUEUED];
+            volatile uint8_t head;
+            uint8_t tail;
+            uint16_t start;
+            volatile bool sending;
+
+            void Notify(NMESSAGE*);
+
+        public:
+            //-------------------------------------------
+            // METHODS
+            /**
+             * @brief Constructor for this component.
+             * @arg baud: standard rate of the bus
+             */
+            BusUart(uint32_t);
+
+            /**
+             * @brief Sets up the pins, USART1 and both DMA channels, and starts receiving.
+             */
+            void Open();
+
+            /**
+             * @brief Sends a frame (copied, the caller's buffer is free on return).
+             * @return false while the previous frame is still going out, or
+             * if the frame is empty or longer than BUS_FRAME_MAX.
+             */
+            bool Write(uint8_t*, uint8_t);
+
+            /**
+             * @brief true from Write() until the transceiver is released.
+             */
+            bool Busy(){ return(sending);}
+
+            /**
+             * @brief Called by USART1_IRQHandler only (idle line, transmission complete).
+             */
+            void UsartIrq();
+
+            /**
+             * @brief Called by DMA1_Channel4_IRQHandler only (transmit DMA complete).
+             */
+            void DmaTxIrq();
+
+            //---------------------------------------
+            // EVENTS
+            /**
+             * @brief A frame was received (called from the main loop).
+             */
+            void (*OnPacket)(uint8_t*, uint8_t);
+
+            /**
+             * @brief About to transmit: enable the transceiver driver.
+             */
+            void (*OnEnterTransmission)(void);
+
+            /**
+             * @brief Last stop bit sent (called from the interrupt): release the bus.
+             */
+            void (*OnLeaveTransmission)(void);
+
+            //---------------------------------------
+            // PROPERTIES
+            /**
+             * @brief Bus rate set by Open(); the BRR may be changed afterwards.
+             */
+            uint32_t Baud;
+
+            /**
+             * @brief NVIC priority of the USART1 and DMA1 channel 4 interrupts.
+             */
+            uint8_t IrqPriority;
+
+            /**
+             * @brief Frames dropped (too long, or too many waiting).
+             */
+            uint16_t Dropped;
+    };
+
+#endif
+//==============================================================================
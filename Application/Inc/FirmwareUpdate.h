@@ -0,0 +1,228 @@
+//==============================================================================
+/**
+ * @file FirmwareUpdate.h
+ * @brief Bus firmware update receiver class\n
+ * This class receives a new firmware image in fixed size blocks (usually
+ * broadcast to every node at once), stores it in the staging slot, keeps
+ * track of missing blocks and finally tags the verified image for the boot
+ * stage (UpdateBoot.cpp), which copies it over the running one.
+ * @version 1.0.0
+ *
+ *------------------------------------------------------------------------------
+ *
+ * This software component is licensed under BSD 3-Clause license, the
+ * "License". You may not use this file except in compliance with the License.
+ *               You may obtain a copy of the License at:
+ *                 opensource.org/licenses/BSD-3-Clause
+ *
+ *///------------------------------------------------------------------------------
+#ifndef FirmwareUpdate_H
+    #define FirmwareUpdate_H
+
+	#include <stdint.h>
+	#include "stm32f1xx.h"
+	#include "BlockMap.h"
+
+	#define UPDATE_BLOCK_SIZE		32
+	#define UPDATE_BLOCKS_MAX		BLOCKMAP_BLOCKS_MAX	// 32K / UPDATE_BLOCK_SIZE
+	#define UPDATE_PAGE_SIZE		1024
+
+	#define UPDATE_TAG_MAGIC		((uint32_t) 0x54445055)	// "UPDT"
+
+	#define UPDATE_STATUS_WINDOW	16		// bitmap bytes per UPDATE_STATUS reply
+	#define UPDATE_REPLY_MAX		(7 + UPDATE_STATUS_WINDOW)
+
+	//-----------------------------------
+	// slot layout, from EDROS_F103_C6_FLASH.ld (shared with the boot stage);
+	// slot B is empty (size 0) unless the link sets UPDATE_FLASH_KB=64
+	extern "C" uint32_t _slot_a_start;
+	extern "C" uint32_t _slot_a_size;
+	extern "C" uint32_t _slot_b_start;
+	extern "C" uint32_t _slot_b_size;
+	extern "C" uint32_t _update_tag;
+
+	#define SLOT_A_START			((uint32_t)(uintptr_t) &_slot_a_start)
+	#define SLOT_A_SIZE				((uint32_t)(uintptr_t) &_slot_a_size)
+	#define SLOT_B_START			((uint32_t)(uintptr_t) &_slot_b_start)
+	#define SLOT_B_SIZE				((uint32_t)(uintptr_t) &_slot_b_size)
+	#define UPDATE_TAG				((uint32_t)(uintptr_t) &_update_tag)
+
+	// flash array size register (in Kbytes)
+	#define DEVICE_FLASH_KB			(*(volatile uint16_t*) 0x1FFFF7E0)
+
+	#define FLASH_KEY1				((uint32_t) 0x45670123)
+	#define FLASH_KEY2				((uint32_t) 0xCDEF89AB)
+
+    //-----------------------------------
+	/**
+	 * @brief Apply request, in the last 16 bytes of the staging slot. Written
+	 * by @ref FirmwareUpdate::Apply(); the boot stage (UpdateBoot.cpp) copies
+	 * the staged image while "done" is erased and marks it done afterwards.
+	 */
+	struct fuTag{
+		uint32_t magic;			//!< UPDATE_TAG_MAGIC
+		uint32_t size;			//!< image size in bytes
+		uint32_t crc;			//!< CRC-32 of the image
+		uint32_t done;			//!< 0xFFFFFFFF: copy pending, 0: copied
+	};
+
+    //-----------------------------------
+	/**
+	 * @enum fuStates
+	 * @brief This enumeration defines the options for the @ref State property.
+	 */
+    enum fuStates { fuIdle,				//!< no update in progress
+    				fuReceiving,		//!< staging slot erased, receiving blocks
+					fuVerified,			//!< all blocks received and image CRC matches
+					fuFailed,			//!< image CRC mismatch or flash error
+					fuUnsupported,		//!< no staging slot in this build or on this device
+					fuBusy,				//!< UPDATE_BEGIN or UPDATE_BLOCK refused, digit moving (reply only)
+    			 };
+
+    //-----------------------------------
+    /** @brief Firmware image receiver\n
+     * Layout (see EDROS_F103_C6_FLASH.ld): slot A is the application region
+     * (FLASH), slot B is in the upper 32K of a 64K flash array, and only
+     * exists in builds linked with UPDATE_FLASH_KB=64. Blocks are written to
+     * slot B only; slot A is rewritten just once, by the boot stage after a
+     * reset, once the whole image is verified.
+     */
+    class FirmwareUpdate{
+
+        private:
+            BlockMap received;
+            uint32_t image_size;
+            uint32_t image_crc;
+            fuStates state;
+
+        public:
+            //-------------------------------------------
+            // FLASH ACCESS (also used for the settings page)
+            /**
+             * @brief Unlocks / locks the flash controller for erase and program.
+             */
+            static void Unlock();
+            static void Lock();
+
+            /**
+             * @brief Checks that "size" bytes at "address" exist on this die
+             * (flash size register), e.g. before touching the upper 32K.
+             */
+            static bool Present(uint32_t, uint32_t);
+
+            /**
+             * @brief Erases the UPDATE_PAGE_SIZE page at "address" (flash unlocked).
+             */
+            static bool ErasePage(uint32_t);
+
+            /**
+             * @brief Programs "size" bytes at "address" (flash unlocked, page erased).
+             */
+            static bool Program(uint32_t, const uint8_t*, uint16_t);
+
+            /**
+             * @brief CRC-32 (IEEE 802.3) of "size" bytes.
+             */
+            static uint32_t Crc32(const uint8_t*, uint32_t);
+
+            //-------------------------------------------
+            // METHODS
+            /**
+             * @brief Constructor for this component.
+             */
+            FirmwareUpdate();
+
+            //-------------------------------------------
+            // BUS COMMANDS
+            // "request" is the command payload (after the PROSA command byte),
+            // "reply" receives the reply payload (after the node address, at
+            // most UPDATE_REPLY_MAX bytes); each returns the reply length.
+            /**
+             * @brief UPDATE_BEGIN: | size (4 bytes) | crc32 (4 bytes) |
+             * reply: | state |
+             * @arg busy: the digit is moving (erasing would stall its PPM tick)
+             */
+            uint8_t OnBegin(const uint8_t*, uint8_t, bool, uint8_t*);
+
+            /**
+             * @brief UPDATE_BLOCK: | index (2 bytes) | data (up to UPDATE_BLOCK_SIZE) |
+             * reply: | state | pending (2 bytes) |
+             * @arg busy: the digit is moving; the block is refused (fuBusy) and
+             * stays missing, to be sent again after UPDATE_STATUS
+             */
+            uint8_t OnBlock(const uint8_t*, uint8_t, bool, uint8_t*);
+
+            /**
+             * @brief UPDATE_STATUS: | offset |
+             * reply: | state | pending (2 bytes) | first (2 bytes) | offset | bitmap |
+             * bitmap: UPDATE_STATUS_WINDOW bytes, bit "n" of byte "k" set =
+             * block (offset + k) * 8 + n missing
+             */
+            uint8_t OnStatus(const uint8_t*, uint8_t, uint8_t*);
+
+            /**
+             * @brief UPDATE_APPLY: no payload; checks the image (see Verify()).
+             * reply: | state |
+             * @note The caller tags the image with Apply() once the reply is
+             * out, if the state is fuVerified.
+             */
+            uint8_t OnApply(uint8_t*);
+
+            /**
+             * @brief Starts a new update: checks the slot, erases it and clears the block map.
+             * @arg size: image size in bytes
+             * @arg crc: CRC-32 (IEEE 802.3) of the whole image
+             * @return false if the image does not fit or the device has no staging slot.
+             * @note Erasing stalls the CPU for about 20ms per 1K page; the
+             * controller must wait UPDATE_ERASE_TIME before sending blocks.
+             */
+            bool Begin(uint32_t, uint32_t);
+
+            /**
+             * @brief Stores one block in the staging slot (duplicates are ignored).
+             * @return false if the block is out of range or could not be written.
+             */
+            bool Block(uint16_t, const uint8_t*, uint8_t);
+
+            /**
+             * @brief Copies "size" bytes of the missing blocks bitmap (1 = missing),
+             * starting at byte "offset", into "buffer".
+             */
+            void Missing(uint8_t* buffer, uint8_t offset, uint8_t size){
+            	received.Missing(buffer, offset, size);
+            }
+
+            /**
+             * @brief Checks the CRC of the staged image.
+             * @return true when the image is complete and valid (state fuVerified).
+             */
+            bool Verify();
+
+            /**
+             * @brief Tags the verified staged image for the boot stage and resets
+             * the MCU; the boot stage copies it over slot A (again after a power
+             * loss, until the copy is complete) and starts it.
+             * @note Does not return unless the tag could not be written (fuFailed).
+             */
+            void Apply();
+
+            //---------------------------------------
+            // PROPERTIES
+            /**
+             * @brief Current update state.
+             */
+            fuStates State(){ return(state);}
+
+            /**
+             * @brief Number of blocks still missing.
+             */
+            uint16_t Pending(){ return(received.Pending());}
+
+            /**
+             * @brief Index of the first missing block (or number of blocks if none).
+             */
+            uint16_t FirstMissing(){ return(received.FirstMissing());}
+    };
+
+#endif
+//==============================================================================
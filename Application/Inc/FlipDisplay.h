@@ -23,85 +23,20 @@
     #define FlipDisplay_H
 
     #include "NHardwareTimer.h"
-	#include "NTinyOutput.h"
-
-    //-----------------------------------
-	/**
-	 * @enum fdStates
-	 * @brief This enumeration defines the options for the @ref state variable.
-	 */
-    enum fdStates { fdServosWaiting,		//!< waiting servos start-up delay
-    				fdServosOn,				//!< waiting servos power-on
-    				fdServos_Start_Clear,
-    	            fdServos_Start_H,   	//!< waiting 4 servos reach new position
-					fdServos_Stop_H,    	//!< waiting 4 servos reach new position
-    	            fdServos_Start_V,   	//!< waiting 4 servos reach new position
-					fdServos_Stop_V,    	//!< waiting 4 servos reach new position
-				    fdServosOff,			//!< waiting servos power-off
-					fdIdle,
-					fdArrowOn,				//!< waiting arrow servos power-on
-					fdArrow_Move,   		//!< waiting arrow servos reach new position
-					fdArrowOff,			//!< waiting arrow servos power-off
-    			 };
+	#include "FlipSequencer.h"
 
     //-----------------------------------
     /** @brief Mechanical, servo driven, 7-segments display abstraction class\n
+     * The move sequence and the PPM pulse generator are the @ref FlipSequencer
+     * this class is built on; the class adds the PPM timebase and the events.
      */
-    class FlipDisplay : private NHardwareTimer{
+    class FlipDisplay : private NHardwareTimer, protected FlipSequencer{
 
         private:
-			#define PPM_TIMEBASE_100us	100
-			#define PPM_PERIOD   		200
-			#define PPM_SEG_SHOWN	  	 14
-			#define PPM_SEG_HIDDEN		  4
-			#define PPM_SEG_CALIBRATE	  4
-			#define PPM_SEG_CLEAR	  	  11
-
-			#define PARAM_SEGMENTS		  0
-			#define PARAM_DUTY			  1
-
-			#define FSM_JUMP	 	 	  2
-			#define FSM_SERVOS_ON	 	 20
-			#define FSM_SERVOS_OFF	 	 10
-			#define FSM_SERVOS_CLEARING	 100
-			#define FSM_SERVOS_MOVING_H	 200
-			#define FSM_SERVOS_MOVING_V	 400
-			#define FSM_ARROW_MOVING	 500
-
-
-			#define SERVOS_DIGIT		 0b01111111
-			#define SERVOS_ARROW		 0b10000000
-    		#define SERVOS_HORIZONTAL	 0b01001001
-			#define SERVOS_VERTICAL		 0b00110110
-			#define SERVOS_CLEAR		 0b00100010
-			#define SERVOS_NONE			 0b00000000
-
-			#define Seg_A				0
-			#define Seg_B				1
-			#define Seg_C				2
-			#define Seg_D				3
-			#define Seg_E				4
-			#define Seg_F				5
-			#define Seg_G				6
-			#define Seg_H				7
-
             //-------------------------
-            fdStates next_state;
-            fdStates current_state;
             uint8_t value;
-            uint8_t previous;
-            uint8_t period;
-            uint8_t duty[8];
-            uint8_t segment[8];
-            uint8_t seg_B;
-            uint8_t seg_F;
-           //volatile bool G_Clear;
-            uint8_t group_to_move;
-            uint8_t previous_g;
-            bool arrow;
-
-            //-------------------------
-            uint32_t fsm_counter;
+            char glyph;
+            bool running;
 
             //-------------------------
             void SetValue(uint8_t);
@@ -110,9 +45,15 @@
             void SetArrow(bool);
             bool GetArrow(void);
 
+            void SetGlyph(char);
+            char GetGlyph(void);
+
+            void SetPattern(uint8_t);
+            uint8_t GetPattern(void);
+
             //-------------------------
-            void Convert(uint8_t);
-            void RunStateMachine();
+            void Show(uint8_t);
+            void StartTimebase();
 
         protected:
             bool ProcessEvent();
@@ -123,35 +64,42 @@
             // METHODS
             /**
              * @brief Constructor for this component.
-             * @arg Port: GPIO to be used (GPIOA, GPIOB, etc.)
-             * @arg Pin: pin number (0 to 15)
-             * @note Make sure the specified GPIO and pin number are valid for
-             * the chosen target MCU.
+             * @arg TIMn: hardware timer of the PPM timebase (TIM2, TIM3, etc.)
              */
             FlipDisplay(TIM_TypeDef*);
 
-
             /**
              * @brief This method is used as a system callback function for message dispatching.
              */
             virtual void Notify(NMESSAGE*);
 
             /**
-             * @brief This method is used as a system callback function for time critical
-             * events dispatching.
+             * @brief Servo segments positioning test command
              */
-            //virtual void InterruptCallBack(NMESSAGE*);
+            void DebugServo(uint8_t*);
 
+            /**
+             * @brief Returns true while the digit is moving or waiting to move.
+             */
+            using FlipSequencer::Busy;
 
             /**
-             * @brief PPM signal control (period / duty)
+             * @brief Sets the servo profile: PPM frame period, tick resolution
+             * and pulse widths. The move phase times (FSM_SERVOS_CLEARING,
+             * FSM_SERVOS_MOVING_H/V, FSM_ARROW_MOVING) scale with the profile
+             * travel time against PPM_TRAVEL_DEFAULT.
+             * @return false (profile unchanged) while moving, or if the tick is
+             * below PPM_TICK_MIN, the frame is shorter than two ticks, a pulse is
+             * shorter than one tick or takes more than 255, a pulse does not
+             * fit in the frame, or the frame (20ms) or the travel
+             * (PPM_TRAVEL_DEFAULT) are longer than the standard analog servo ones.
              */
-            void Run(uint8_t);
+            using FlipSequencer::SetProfile;
 
             /**
-             * @brief Servo segments positioning test command
+             * @brief Returns the servo profile in use.
              */
-            void DebugServo(uint8_t*);
+            using FlipSequencer::Profile;
 
             //---------------------------------------
             // EVENTS
@@ -163,20 +111,23 @@
             void (*OnValueUpdate)(void);
 
             /**
-             * @brief This is the event handler for "button press".
-             * @note This event can be used when @ref swButton mode is selected.
+             * @brief This is the event handler for move phase starts.
+             * - This event handler is called as each move phase (RAMP_CLEAR,
+             * RAMP_H, RAMP_V, RAMP_ARROW) starts, with the phase and the bitmask
+             * of the powered segments that are about to change position.
              */
-            //id (*OnPress)(void);
+            void (*OnMoveStart)(uint8_t, uint8_t);
 
             /**
-             * @brief This is the event handler for "button release".
-             * @note This event can be used when @ref swButton mode is selected.
+             * @brief Length (ms) of the phase just started, ramp included
+             * (valid from OnMoveStart).
              */
-            //void (*OnRelease)(void);
+            using FlipSequencer::PhaseLength;
 
             //---------------------------------------
             // PROPERTIES
             using NComponent::Tag;
+            using NHardwareTimer::IrqPriority;
 
             bool Enabled;
 
@@ -191,25 +142,42 @@
              */
             property<FlipDisplay, bool, propReadWrite> Arrow;
 
+            /**
+             * @brief This property is used to show an ASCII character (see @ref glyph_table).
+             * @note Characters without a 7-segments representation are shown blank.
+             */
+            property<FlipDisplay, char, propReadWrite> Glyph;
+
+            /**
+             * @brief This property is used to show a raw segments bitmask (bit 0 = A ... bit 6 = G).
+             */
+            property<FlipDisplay, uint8_t, propReadWrite> Pattern;
+
             /**
              * @brief This property is used to define the hardware output for horizontal segments servo power line.
              */
-            NTinyOutput* Driver_H;
+            using FlipSequencer::Driver_H;
 
             /**
              * @brief This property is used to define the hardware output for vertical segments servo power line.
              */
-            NTinyOutput* Driver_V;
+            using FlipSequencer::Driver_V;
 
             /**
              * @brief This property is used to define the hardware output for each segment.
              */
-            NTinyOutput* Segment[8];
+            using FlipSequencer::Segment;
+
+            /**
+             * @brief Motion ramp length, in PPM frames, for each move phase
+             * (see @ref FlipSequencer::Ramp).
+             */
+            using FlipSequencer::Ramp;
 
             /**
              * @brief This property is used to assign new "delay" to display.
              */
-            uint16_t Delay;
+            using FlipSequencer::Delay;
 
 
     };
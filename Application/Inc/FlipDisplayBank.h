@@ -0,0 +1,189 @@
+//==============================================================================
+/**
+ * @file FlipDisplayBank.h
+ * @brief Multi-digit mechanical display driver class\n
+ * This class drives up to four servo based 7-segments digits (one
+ * @ref FlipSequencer each) from a single hardware timer, interleaving their
+ * PPM frames and scheduling their moves under a common servo current budget.
+ * @version 1.0.0
+ * @author PLT01_DGT02 contributors
+ *
+ *------------------------------------------------------------------------------
+ *
+ * This software component is licensed under BSD 3-Clause license, the
+ * "License". You may not use this file except in compliance with the License.
+ *               You may obtain a copy of the License at:
+ *                 opensource.org/licenses/BSD-3-Clause
+ *
+ *///------------------------------------------------------------------------------
+#ifndef FlipDisplayBank_H
+    #define FlipDisplayBank_H
+
+    #include "NHardwareTimer.h"
+	#include "FlipSequencer.h"
+
+	#define BANK_DIGITS_MAX		4
+
+	// number of servos powered at once by each kind of move
+	#define BANK_LOAD_DIGIT		4
+	#define BANK_LOAD_ARROW		1
+
+    //-----------------------------------
+    /** @brief Mechanical, servo driven, multi-digit display abstraction class\n
+     * All digits share one timebase and one servo profile: each PPM tick runs
+     * the pulse generator of every admitted digit, with the frame start of
+     * digit "n" shifted by n / Digits of a frame so that no two digits raise
+     * their segment lines on the same tick.
+     * @note The DGT-02 node drives one digit with @ref FlipDisplay; the bank
+     * is for boards that carry several digits (see Tests/FlipSequencerTest.cpp).
+     */
+    class FlipDisplayBank : private NHardwareTimer{
+
+        protected:
+            //-------------------------
+            FlipSequencer* channel;
+            uint8_t digits;
+            uint16_t frame;
+            uint16_t ppm_period;
+            uint8_t load;
+            uint8_t share[BANK_DIGITS_MAX];
+            uint8_t value[BANK_DIGITS_MAX];
+            char glyph[BANK_DIGITS_MAX];
+            bool running;
+
+            //-------------------------
+            void Show(uint8_t, uint8_t);
+            bool Admit(uint8_t, uint8_t);
+            void Release(uint8_t);
+            void StartTimebase();
+            void StopTimebase();
+
+            // shared frame position, one step per PPM tick
+            void Advance(){ if(frame > 0){ frame--;} else { frame = ppm_period;}}
+
+            void ValueUpdated(uint8_t);
+            void MoveStarted(uint8_t, uint8_t, uint8_t);
+
+            bool ProcessEvent();
+
+        //-------------------------------------------
+        public:
+            //-------------------------------------------
+            // METHODS
+            /**
+             * @brief Constructor for this component.
+             * @arg TIMn: hardware timer shared by all digits (TIM2, TIM3, etc.)
+             * @arg Digits: number of digits driven by this bank (1 to BANK_DIGITS_MAX)
+             */
+            FlipDisplayBank(TIM_TypeDef*, uint8_t);
+
+            /**
+             * @brief This method is used as a system callback function for message dispatching.
+             */
+            virtual void Notify(NMESSAGE*);
+
+            /**
+             * @brief Assigns a new value (0..15, blank above) to one digit of the bank.
+             */
+            void SetValue(uint8_t, uint8_t);
+
+            /**
+             * @brief Returns the value assigned to one digit of the bank.
+             */
+            uint8_t GetValue(uint8_t);
+
+            /**
+             * @brief Shows an ASCII character (see @ref glyph_table) on one digit of the bank.
+             */
+            void SetGlyph(uint8_t, char);
+
+            /**
+             * @brief Returns the character assigned to one digit of the bank.
+             */
+            char GetGlyph(uint8_t);
+
+            /**
+             * @brief Shows a raw segments bitmask (bit 0 = A ... bit 6 = G) on one digit of the bank.
+             */
+            void SetPattern(uint8_t, uint8_t);
+
+            /**
+             * @brief Returns the segments bitmask shown by one digit of the bank.
+             */
+            uint8_t GetPattern(uint8_t);
+
+            /**
+             * @brief Assigns a new arrow status (segment H) to one digit of the bank.
+             */
+            void SetArrow(uint8_t, bool);
+
+            /**
+             * @brief Returns the arrow status of one digit of the bank.
+             */
+            bool GetArrow(uint8_t);
+
+            /**
+             * @brief Servo segments positioning test command for one digit.
+             */
+            void DebugServo(uint8_t, uint8_t*);
+
+            /**
+             * @brief Returns true while any digit of the bank is moving or waiting to move.
+             */
+            bool Busy();
+
+            /**
+             * @brief Sets the servo profile of every digit, see @ref FlipDisplay::SetProfile().
+             */
+            bool SetProfile(const fdProfile&);
+
+            /**
+             * @brief Returns the servo profile in use.
+             */
+            fdProfile Profile(){ return(channel[0].Profile());}
+
+            /**
+             * @brief Returns the sequencer of one digit, to set its outputs, "Delay"
+             * and "Ramp" (NULL if out of range).
+             */
+            FlipSequencer* Channel(uint8_t);
+
+            /**
+             * @brief Returns the number of digits in the bank.
+             */
+            uint8_t Digits(){ return(digits);}
+
+            //---------------------------------------
+            // EVENTS
+            /**
+             * @brief This is the event handler for value updates.
+             * - This event handler is called with the digit index every time
+             * a digit finishes moving to its new value.
+             */
+            void (*OnValueUpdate)(uint8_t);
+
+            /**
+             * @brief This is the event handler for move phase starts.
+             * - This event handler is called with the digit index, the phase
+             * (RAMP_CLEAR .. RAMP_ARROW) and the bitmask of the powered segments
+             * that are about to change position.
+             */
+            void (*OnMoveStart)(uint8_t, uint8_t, uint8_t);
+
+            //---------------------------------------
+            // PROPERTIES
+            using NComponent::Tag;
+            using NHardwareTimer::IrqPriority;
+
+            bool Enabled;
+
+            /**
+             * @brief Maximum number of servos allowed to be powered at the same time.
+             * @note Digit moves take BANK_LOAD_DIGIT and arrow moves take
+             * BANK_LOAD_ARROW from this budget until they finish.
+             */
+            uint8_t Budget;
+    };
+
+#endif
+//==============================================================================
@@ -0,0 +1,150 @@
+//==============================================================================
+/**
+ * @file FlipDisplayFixed.h
+ * @brief Mechanical display driver class for a fixed pin map\n
+ * Compile-time specialised version of @ref FlipDisplay: the segments port,
+ * first pin and segment count are template parameters, so the PPM tick
+ * writes all the segment lines with one BRR and one BSRR write instead of
+ * one NTinyOutput call (and NULL check) per segment.
+ * @version 1.0.0
+ *
+ *------------------------------------------------------------------------------
+ *
+ * This software component is licensed under BSD 3-Clause license, the
+ * "License". You may not use this file except in compliance with the License.
+ *               You may obtain a copy of the License at:
+ *                 opensource.org/licenses/BSD-3-Clause
+ *
+ *///------------------------------------------------------------------------------
+#ifndef FlipDisplayFixed_H
+    #define FlipDisplayFixed_H
+
+    #include "FlipDisplay.h"
+	#include "Benchmark.h"
+	#include "MemoryStats.h"
+
+	// the per segment steps must not stay calls, whatever the optimisation level
+	#define FIXED_INLINE	inline __attribute__((always_inline))
+
+    //-----------------------------------
+    /** @brief Mechanical, servo driven, 7-segments display with a fixed pin map\n
+     * @arg SEG_PORT: base address of the segments GPIO (GPIOB_BASE, etc.)
+     * @arg SEG_PIN0: pin of segment A; segment "n" is on pin SEG_PIN0 + n
+     * @arg SEGMENTS: 7 (digit only) or 8 (digit + arrow on segment H)
+     *
+     * Usage for the DGT-02 pin map (see Application.h):
+     * @code
+     * FlipDisplay* Digit = new FlipDisplayFixed<GPIOB_BASE, 0, 8>(TIM2);
+     * @endcode
+     * @note The PPM tick is FlipSequencer::Run() unrolled for each of the
+     * group masks the move sequence uses (SERVOS_CLEAR, SERVOS_HORIZONTAL,
+     * SERVOS_DIGIT, SERVOS_ARROW): one switch, then straight-line code per
+     * segment and at most one BRR and one BSRR write. Only DebugServo() moves,
+     * with arbitrary groups, take the generic Run(). The move sequence (1ms)
+     * and the servo power lines are the @ref FlipSequencer ones, and the
+     * segment pins are still set up as outputs through "Segment"
+     * (NTinyOutput). The timer interrupt is owned by NHardwareTimer, so one
+     * virtual call to ProcessEvent() remains per tick.
+     */
+    template<uint32_t SEG_PORT, uint8_t SEG_PIN0, uint8_t SEGMENTS>
+    class FlipDisplayFixed : public FlipDisplay{
+
+    	static_assert((SEGMENTS == 7) || (SEGMENTS == 8), "FlipDisplayFixed: 7 or 8 segments");
+    	static_assert((SEG_PIN0 + SEGMENTS) <= 16, "FlipDisplayFixed: segment pins out of range");
+
+    	static const uint8_t SEG_MASK = (SEGMENTS == 8) ? (SERVOS_DIGIT | SERVOS_ARROW) : SERVOS_DIGIT;
+
+    	//-------------------------
+    	// pulse countdown of segment C, see FlipSequencer::Run()
+    	template<uint8_t GROUP, uint8_t C>
+    	FIXED_INLINE void Count(uint8_t& low){
+    		if(GROUP & (0x01 << C)){
+    			if(duty[C] > 0){ duty[C]--;}
+    			else {
+    				duty[C] = pulse[C];
+    				low |= (0x01 << C);
+    			}
+    		}
+    	}
+
+    	//-------------------------
+    	// frame start of segment C: next point of the ramp (or the target)
+    	template<uint8_t GROUP, uint8_t C>
+    	FIXED_INLINE void Reload(){
+    		if(GROUP & (0x01 << C)){
+    			if(ramp_step < ramp_length){
+    				int16_t span = (int16_t) segment[C] - origin[C];
+    				pulse[C] = (uint8_t)(origin[C] + (span * ramp_step) / ramp_length);
+    			} else {
+    				pulse[C] = segment[C];
+    			}
+    			duty[C] = pulse[C];
+    		}
+    	}
+
+    	//-------------------------
+    	template<uint8_t GROUP>
+    	FIXED_INLINE void Pulse(){
+    		if(period > 0){
+    			uint8_t low = 0x00;
+    			period--;
+    			Count<GROUP, 0>(low); Count<GROUP, 1>(low);
+    			Count<GROUP, 2>(low); Count<GROUP, 3>(low);
+    			Count<GROUP, 4>(low); Count<GROUP, 5>(low);
+    			Count<GROUP, 6>(low); Count<GROUP, 7>(low);
+    			low &= SEG_MASK;
+    			if(low){ ((GPIO_TypeDef*) SEG_PORT)->BRR = ((uint32_t) low << SEG_PIN0);}
+    		} else {
+    			period = ppm_period;
+    			if(ramp_step < ramp_length){ ramp_step++;}
+    			Reload<GROUP, 0>(); Reload<GROUP, 1>();
+    			Reload<GROUP, 2>(); Reload<GROUP, 3>();
+    			Reload<GROUP, 4>(); Reload<GROUP, 5>();
+    			Reload<GROUP, 6>(); Reload<GROUP, 7>();
+    			if(((GROUP & SEG_MASK) != 0) &&
+    					((current_state == fdServos_Start_Clear)||(current_state == fdServos_Start_H)||
+    					(current_state == fdServos_Start_V)||(current_state == fdArrow_Move))){
+    				// set the "duty signal x" lines high again
+    				((GPIO_TypeDef*) SEG_PORT)->BSRR = ((uint32_t)(GROUP & SEG_MASK) << SEG_PIN0);
+    			}
+    		}
+    	}
+
+        protected:
+            //-------------------------
+            bool ProcessEvent(){
+            	BENCH_BEGIN(BENCH_PPM_TICK);
+            	MemSample();
+            	if(Enabled){
+            		switch(group_to_move){
+            			case SERVOS_CLEAR: Pulse<SERVOS_CLEAR>(); break;
+            			case SERVOS_HORIZONTAL: Pulse<SERVOS_HORIZONTAL>(); break;
+            			case SERVOS_DIGIT: Pulse<SERVOS_DIGIT>(); break;
+            			case SERVOS_ARROW: Pulse<SERVOS_ARROW>(); break;
+            			default:{
+            				// DebugServo() groups
+            				uint8_t high;
+            				uint8_t low = Run(high) & SEG_MASK;
+            				high &= SEG_MASK;
+            				if(low){ ((GPIO_TypeDef*) SEG_PORT)->BRR = ((uint32_t) low << SEG_PIN0);}
+            				if(high){ ((GPIO_TypeDef*) SEG_PORT)->BSRR = ((uint32_t) high << SEG_PIN0);}
+            			}	break;
+            		}
+            	}
+            	BENCH_END(BENCH_PPM_TICK);
+            	return(true);
+            }
+
+        //-------------------------------------------
+        public:
+            //-------------------------------------------
+            // METHODS
+            /**
+             * @brief Constructor for this component.
+             * @arg TIMn: hardware timer of the PPM timebase (TIM2, TIM3, etc.)
+             */
+            FlipDisplayFixed(TIM_TypeDef* TIMn):FlipDisplay(TIMn){}
+    };
+
+#endif
+//==============================================================================
@@ -0,0 +1,324 @@
+//==============================================================================
+/**
+ * @file FlipSequencer.h
+ * @brief Mechanical display digit sequencer class\n
+ * This class holds the move sequence (state machine) and the PPM pulse
+ * generator of one servo driven 7-segments digit. It owns no timer: the
+ * display classes built on it (@ref FlipDisplay, @ref FlipDisplayBank) call
+ * Tick() every millisecond and Run() on every PPM tick, and write the segment
+ * lines Run() reports.
+ * @version 1.0.0
+ * @author Joao Nilo Rodrigues - nilo@pobox.com
+ *
+ *------------------------------------------------------------------------------
+ *
+ * <h2><center>&copy; Copyright (c) 2020 Joao Nilo Rodrigues
+ * All rights reserved.</center></h2>
+ *
+ * This software component is licensed by "Joao Nilo Rodrigues" under BSD 3-Clause
+ * license, the "License".
+ * You may not use this file except in compliance with the License.
+ *               You may obtain a copy of the License at:
+ *                 opensource.org/licenses/BSD-3-Clause
+ *
+ *///------------------------------------------------------------------------------
+#ifndef FlipSequencer_H
+    #define FlipSequencer_H
+
+	#include "NTinyOutput.h"
+
+    //-----------------------------------
+	/**
+	 * @enum fdStates
+	 * @brief This enumeration defines the options for the @ref state variable.
+	 */
+    enum fdStates { fdServosWaiting,		//!< waiting servos start-up delay
+    				fdServosOn,				//!< waiting servos power-on
+    				fdServos_Start_Clear,
+    	            fdServos_Start_H,   	//!< waiting 4 servos reach new position
+					fdServos_Stop_H,    	//!< waiting 4 servos reach new position
+    	            fdServos_Start_V,   	//!< waiting 4 servos reach new position
+					fdServos_Stop_V,    	//!< waiting 4 servos reach new position
+				    fdServosOff,			//!< waiting servos power-off
+					fdIdle,
+					fdArrowOn,				//!< waiting arrow servos power-on
+					fdArrow_Move,   		//!< waiting arrow servos reach new position
+					fdArrowOff,			//!< waiting arrow servos power-off
+    			 };
+
+    //-----------------------------------
+	/**
+	 * @enum fsShow
+	 * @brief Result of @ref FlipSequencer::Show().
+	 */
+    enum fsShow { fsStarted,				//!< move started (the PPM timebase must run)
+    			  fsPending,				//!< digit busy, latched and shown by a new move once this one is over
+    			  fsShown					//!< pattern already on display
+    			};
+
+	#define PPM_TIMEBASE_100us	100
+	#define PPM_PERIOD   		200
+	#define PPM_SEG_SHOWN	  	 14
+	#define PPM_SEG_HIDDEN		  4
+	#define PPM_SEG_CALIBRATE	  4
+	#define PPM_SEG_CLEAR	  	  11
+
+	#define PARAM_SEGMENTS		  0
+	#define PARAM_DUTY			  1
+
+	#define FSM_JUMP	 	 	  2
+	#define FSM_SERVOS_ON	 	 20
+	#define FSM_SERVOS_OFF	 	 10
+	#define FSM_SERVOS_CLEARING	 100
+	#define FSM_SERVOS_MOVING_H	 200
+	#define FSM_SERVOS_MOVING_V	 400
+	#define FSM_ARROW_MOVING	 500
+
+	#define PPM_TICK_MIN		 20		// us, PPM interrupt load limit
+	#define PPM_TRAVEL_DEFAULT	200		// ms, servo travel the FSM_* times are set for
+
+	#define RAMP_CLEAR			  0
+	#define RAMP_H				  1
+	#define RAMP_V				  2
+	#define RAMP_ARROW			  3
+	#define RAMP_PHASES			  4
+	#define RAMP_FRAMES_MAX		  8		// longest ramp of one phase, in PPM frames
+	#define PPM_FRAME_MAX_MS	((PPM_TIMEBASE_100us * PPM_PERIOD) / 1000)
+
+	#define SERVOS_DIGIT		 0b01111111
+	#define SERVOS_ARROW		 0b10000000
+	#define SERVOS_HORIZONTAL	 0b01001001
+	#define SERVOS_VERTICAL		 0b00110110
+	#define SERVOS_CLEAR		 0b00100010
+	#define SERVOS_NONE			 0b00000000
+
+	#define Seg_A				0
+	#define Seg_B				1
+	#define Seg_C				2
+	#define Seg_D				3
+	#define Seg_E				4
+	#define Seg_F				5
+	#define Seg_G				6
+	#define Seg_H				7
+
+	// FlipSequencer::Tick() events (bitmask)
+	#define SEQ_PHASE			0x01	// a move phase started, see Phase() and Moving()
+	#define SEQ_DONE			0x02	// the digit move finished (value update)
+	#define SEQ_IDLE			0x04	// the sequence is over, servos unpowered
+
+    //-----------------------------------
+    /** @brief Value (0..15, 16 = blank) to segments conversion table.
+     */
+    extern const uint8_t conversion_table[17];
+
+    //-----------------------------------
+    /** @brief ASCII (0x20..0x7F) to segments glyph table.
+     */
+    extern const uint8_t glyph_table[96];
+
+    //-----------------------------------
+    /** @brief Servo profile: PPM timing and pulse widths in microseconds,
+     * servo travel time (hidden to shown) in milliseconds.
+     */
+    struct fdProfile{
+    	uint16_t tick;			//!< PPM resolution (timebase period)
+    	uint16_t frame;			//!< PPM frame period
+    	uint16_t shown;			//!< pulse width, segment shown
+    	uint16_t hidden;		//!< pulse width, segment hidden
+    	uint16_t clear;			//!< pulse width, segments B and F cleared
+    	uint16_t travel;		//!< servo travel time (ms)
+    };
+
+    //-----------------------------------
+    /** @brief Standard analog servos: 50Hz frames, 100us resolution.
+     */
+    extern const fdProfile profile_analog;
+
+    //-----------------------------------
+    /** @brief Move sequence and PPM pulse generator of one digit\n
+     */
+    class FlipSequencer{
+
+        protected:
+            //-------------------------
+            // (protected: FlipDisplayFixed runs the PPM tick on them inline)
+            fdStates next_state;
+            fdStates current_state;
+            uint8_t pattern;
+            uint8_t target;
+            uint8_t previous;
+            bool arrow;
+            fdProfile profile;
+            uint16_t period;
+            uint16_t ppm_period;
+            uint8_t seg_shown;
+            uint8_t seg_hidden;
+            uint8_t seg_clear;
+            uint8_t fsm_frame;
+            uint16_t phase_time[RAMP_PHASES];
+            uint8_t duty[8];
+            uint8_t segment[8];
+            uint8_t pulse[8];
+            uint8_t origin[8];
+            uint8_t ramp_step;
+            uint8_t ramp_length;
+            uint8_t seg_B;
+            uint8_t seg_F;
+            uint8_t group_to_move;
+            uint8_t phase;
+            uint8_t moving;
+            uint16_t phase_length;
+
+            //-------------------------
+            uint32_t fsm_counter;
+
+            //-------------------------
+            void Convert(uint8_t);
+            void StartRamp(uint8_t);
+            bool Latched();
+
+        //-------------------------------------------
+        public:
+            //-------------------------------------------
+            // METHODS
+            /**
+             * @brief Constructor for this component (standard analog servos).
+             */
+            FlipSequencer();
+
+            /**
+             * @brief Starts moving the digit servos to the given segments bitmask
+             * (A..G). Only a bitmask different from the one on display causes a move.
+             * @note While the digit is busy the bitmask is latched (the last one
+             * wins) and moved to as soon as the move under way is over.
+             */
+            fsShow Show(uint8_t);
+
+            /**
+             * @brief Sets the arrow status (segment H).
+             * @return true if an arrow move was started (the PPM timebase must run).
+             */
+            bool SetArrow(bool);
+
+            /**
+             * @brief Servo segments positioning test command (see PARAM_SEGMENTS,
+             * PARAM_DUTY; duty in 100us units).
+             * @return true if the move was started (the PPM timebase must run).
+             */
+            bool DebugServo(uint8_t*);
+
+            /**
+             * @brief Sets the servo profile, see @ref FlipDisplay::SetProfile().
+             */
+            bool SetProfile(const fdProfile&);
+
+            /**
+             * @brief Advances the move sequence by one millisecond.
+             * @return SEQ_PHASE, SEQ_DONE and SEQ_IDLE events.
+             */
+            uint8_t Tick();
+
+            /**
+             * @brief Runs one PPM tick.
+             * @arg high: segment lines (bit 0 = A ... bit 7 = H) to be driven high.
+             * @return segment lines to be driven low.
+             */
+            uint8_t Run(uint8_t&);
+
+            /**
+             * @brief Writes the lines returned by Run() to "Segment".
+             */
+            void Output(uint8_t, uint8_t);
+
+            /**
+             * @brief Restarts the PPM frame "n" ticks before its end.
+             */
+            void Align(uint16_t n){ period = n;}
+
+            //---------------------------------------
+            // PROPERTIES
+            /**
+             * @brief Returns true while the digit is moving or waiting to move.
+             */
+            bool Busy(){ return(next_state != fdIdle);}
+
+            /**
+             * @brief Returns true when the next Tick() leaves the current state.
+             */
+            bool Due(){ return((next_state != fdIdle) && (fsm_counter == 0));}
+
+            /**
+             * @brief Returns the next state of the move sequence.
+             */
+            fdStates State(){ return(next_state);}
+
+            /**
+             * @brief Returns the segments bitmask on display, or the one the
+             * digit is moving (or about to move) to.
+             */
+            uint8_t Pattern(){ return(pattern);}
+
+            /**
+             * @brief Returns the arrow status (segment H).
+             */
+            bool Arrow(){ return(arrow);}
+
+            /**
+             * @brief Returns the servo profile in use.
+             */
+            fdProfile Profile(){ return(profile);}
+
+            /**
+             * @brief Returns the PPM frame length, in ticks, minus one.
+             */
+            uint16_t Frame(){ return(ppm_period);}
+
+            /**
+             * @brief Last move phase started (RAMP_CLEAR .. RAMP_ARROW).
+             */
+            uint8_t Phase(){ return(phase);}
+
+            /**
+             * @brief Powered segments about to change position in the last phase started.
+             */
+            uint8_t Moving(){ return(moving);}
+
+            /**
+             * @brief Length (ms) of the last phase started, ramp included.
+             */
+            uint16_t PhaseLength(){ return(phase_length);}
+
+            /**
+             * @brief This property is used to define the hardware output for horizontal segments servo power line.
+             */
+            NTinyOutput* Driver_H;
+
+            /**
+             * @brief This property is used to define the hardware output for vertical segments servo power line.
+             */
+            NTinyOutput* Driver_V;
+
+            /**
+             * @brief This property is used to define the hardware output for each segment.
+             */
+            NTinyOutput* Segment[8];
+
+            /**
+             * @brief Motion ramp length, in PPM frames, for each move phase
+             * (RAMP_CLEAR, RAMP_H, RAMP_V, RAMP_ARROW).
+             * - With a ramp, the pulse width of the moving servos steps from the
+             * old to the new position over "n" frames instead of jumping, so the
+             * servos do not all hit stall current at once. 0 (default) = no ramp,
+             * longer ramps are cut to RAMP_FRAMES_MAX.
+             * @note Each phase is lengthened by its ramp time.
+             */
+            uint8_t Ramp[RAMP_PHASES];
+
+            /**
+             * @brief Start-up delay (ms) before a digit move.
+             */
+            uint16_t Delay;
+    };
+
+#endif
+//==============================================================================
@@ -0,0 +1,75 @@
+//==============================================================================
+/**
+ * @file MemoryStats.h
+ * @brief Stack and heap high-water marks\n
+ * Paints the reserved stack area at start-up and finds the deepest word
+ * ever written; samples the stack pointer in thread and handler mode to
+ * split main and interrupt usage; counts heap allocations through the
+ * malloc / free linker wrappers (-Wl,--wrap=malloc,--wrap=free).
+ * Only the painting is always built in: the sampling and the heap wrappers
+ * (8 bytes more per block) need DIAGNOSTICS_ENABLED.
+ * @version 1.0.0
+ *
+ *------------------------------------------------------------------------------
+ *
+ * This software component is licensed under BSD 3-Clause license, the
+ * "License". You may not use this file except in compliance with the License.
+ *               You may obtain a copy of the License at:
+ *                 opensource.org/licenses/BSD-3-Clause
+ *
+ *///------------------------------------------------------------------------------
+#ifndef MemoryStats_H
+    #define MemoryStats_H
+
+	#include <stdint.h>
+	#include "stm32f1xx.h"
+
+	//-----------------------------------
+	// Defined by the "Diagnostics" build configuration (.cproject), together
+	// with the -Wl,--wrap=malloc,free,calloc,realloc linker flags; the two go
+	// together or the link fails. Without it, MemSample() compiles to nothing
+	// and the main / interrupt split and heap items read 0.
+	//#define DIAGNOSTICS_ENABLED
+
+	#define MEM_PAINT			((uint32_t) 0xC5C5C5C5)
+	#define MEM_PAINT_MARGIN	64			// bytes kept below SP while painting
+
+	#define MEM_STACK_SIZE		0			// reserved stack (_Min_Stack_Size)
+	#define MEM_STACK_PEAK		1			// deepest painted word reached
+	#define MEM_STACK_MAIN		2			// deepest sample in thread mode
+	#define MEM_STACK_ISR		3			// peak - main: interrupt share (upper bound)
+	#define MEM_HEAP_USED		4			// bytes allocated now (with headers)
+	#define MEM_HEAP_PEAK		5			// highest "used"
+	#define MEM_HEAP_BLOCKS		6			// live allocations
+	#define MEM_HEAP_EXTENT		7			// highest block end - lowest block start
+	#define MEM_HEAP_FRAG		8			// (extent - used) / extent, per mille
+	#define MEM_ITEMS			9
+
+	extern uint32_t MemMainSP;
+	extern uint32_t MemIsrSP;
+
+	/**
+	 * @brief Paints the reserved stack area below the current stack pointer.
+	 * @note Call first thing in ApplicationCreate(), while the stack is shallow.
+	 */
+	void MemPaint();
+
+	/**
+	 * @brief Fills "result" with the MEM_ITEMS statistics (bytes, frag in per mille).
+	 */
+	void MemRead(uint32_t*);
+
+	/**
+	 * @brief Records the stack pointer, as main (thread mode) or interrupt
+	 * (handler mode) usage. Cheap enough for the PPM tick.
+	 */
+	static inline void MemSample(){
+	#ifdef DIAGNOSTICS_ENABLED
+		uint32_t sp = __get_MSP();
+		if(__get_IPSR() == 0){ if(sp < MemMainSP){ MemMainSP = sp;}}
+		else { if(sp < MemIsrSP){ MemIsrSP = sp;}}
+	#endif
+	}
+
+#endif
+//==============================================================================
@@ -0,0 +1,130 @@
+//==============================================================================
+/**
+ * @file ServoSignature.h
+ * @brief Servo current signature analysis class\n
+ * This class reduces a current trace captured while a servo group moves to a
+ * few features (peak, settle time and energy), learns their normal values for
+ * each move phase and, from the moves that fall out of range, narrows down
+ * the segments to blame.
+ * @version 1.0.0
+ *
+ *------------------------------------------------------------------------------
+ *
+ * This software component is licensed under BSD 3-Clause license, the
+ * "License". You may not use this file except in compliance with the License.
+ *               You may obtain a copy of the License at:
+ *                 opensource.org/licenses/BSD-3-Clause
+ *
+ *///------------------------------------------------------------------------------
+#ifndef ServoSignature_H
+    #define ServoSignature_H
+
+	#include <stdint.h>
+
+	#define SIGNATURE_PHASES		4		// same order as RAMP_CLEAR .. RAMP_ARROW
+	#define SIGNATURE_LEARN			8		// moves averaged before faults are checked
+	#define SIGNATURE_DEAD_SHARE	2		// short move: lacks 1/2 of one servo's energy
+	#define SIGNATURE_JAM_RATIO		3		// a stalled servo draws 3x its moving energy
+	#define SIGNATURE_PEAK_RATIO	2		// a stalled or shorted servo peaks at 2x its share
+	#define SIGNATURE_RECUR			3		// bad moves in a row before a segment is faulty
+
+    //-----------------------------------
+	/** @brief Features of one move, normalised per moving servo.
+	 */
+	struct ssFeatures{
+		uint16_t peak;			//!< highest sample above the pre-move level
+		uint16_t energy;		//!< sum of samples above the pre-move level (/16)
+		uint8_t settle;			//!< last sample above peak / 4 (in samples)
+	};
+
+    //-----------------------------------
+    /** @brief Servo current signature analyser\n
+     * All the processing is integer and linear in the number of samples, so it
+     * fits between two PPM ticks.
+     */
+    class ServoSignature{
+
+        private:
+            uint8_t phase;
+            uint8_t segments;
+            uint8_t moving;
+            uint8_t suspect[8];
+            uint8_t candidates;
+
+        public:
+            //-------------------------------------------
+            // METHODS
+            /**
+             * @brief Constructor for this component.
+             */
+            ServoSignature();
+
+            /**
+             * @brief Prepares the analysis of a new move.
+             * @arg phase: move phase (0 to SIGNATURE_PHASES - 1)
+             * @arg segments: bitmask of the segments actually changing position
+             */
+            void Begin(uint8_t, uint8_t);
+
+            /**
+             * @brief Reduces a captured current trace and checks it against the baseline.
+             * - A move is bad when its energy is too low (one servo dead), or
+             * when it draws too much: energy too high with the current still up
+             * at the end of the capture, or a peak too high (one servo stalled
+             * or shorted). The limits scale with the number of moving servos,
+             * so that one servo shows even in a four-servo phase.
+             * - Attribution: the suspect set is the intersection of the segments
+             * of the bad moves (started over when it would be empty), less the
+             * segments of good moves. A segment is only reported once it is in
+             * the set and took part in SIGNATURE_RECUR bad moves in a row.
+             * Segments that always move together (B and F in the clear phase)
+             * cannot be told apart and are reported together.
+             * @return bitmask of the segments found faulty in this move.
+             */
+            uint8_t Process(uint16_t*, uint16_t);
+
+            /**
+             * @brief Clears the faults (baselines are kept).
+             */
+            void ClearFaults();
+
+            /**
+             * @brief Takes saved baselines (one per phase) as fully learned.
+             */
+            void Load(const ssFeatures*);
+
+            /**
+             * @brief Drops the baselines: the next moves are learned again.
+             */
+            void Forget();
+
+            /**
+             * @brief true once every phase has learned its baseline.
+             */
+            bool Complete();
+
+            //---------------------------------------
+            // PROPERTIES
+            /**
+             * @brief Last features measured for each phase.
+             */
+            ssFeatures Last[SIGNATURE_PHASES];
+
+            /**
+             * @brief Learned (averaged) features for each phase.
+             */
+            ssFeatures Baseline[SIGNATURE_PHASES];
+
+            /**
+             * @brief Number of moves averaged in each baseline (up to SIGNATURE_LEARN).
+             */
+            uint8_t Learned[SIGNATURE_PHASES];
+
+            /**
+             * @brief Faulty segments (sticky, one bit per segment, same as "myBITE").
+             */
+            uint8_t Faults;
+    };
+
+#endif
+//==============================================================================
@@ -0,0 +1,120 @@
+//==============================================================================
+/**
+ * @file TennisScore.h
+ * @brief Tennis scoring state machine class\n
+ * This class keeps the score of a best of three sets match, applies one-byte
+ * match events to it (point, undo, new set, switch server) and renders it in
+ * the layout of the "ScoreParams" table. Every node runs the same machine
+ * on the same events, so they all reach the same score.
+ * @version 1.0.0
+ *
+ *------------------------------------------------------------------------------
+ *
+ * This software component is licensed under BSD 3-Clause license, the
+ * "License". You may not use this file except in compliance with the License.
+ *               You may obtain a copy of the License at:
+ *                 opensource.org/licenses/BSD-3-Clause
+ *
+ *///------------------------------------------------------------------------------
+#ifndef TennisScore_H
+    #define TennisScore_H
+
+	#include <stdint.h>
+
+	// match events
+	#define SCORE_EV_POINT_P1		((uint8_t) 0x01)
+	#define SCORE_EV_POINT_P2		((uint8_t) 0x02)
+	#define SCORE_EV_UNDO			((uint8_t) 0x03)
+	#define SCORE_EV_NEW_SET		((uint8_t) 0x04)
+	#define SCORE_EV_SWITCH_SERVER	((uint8_t) 0x05)
+	#define SCORE_EV_NEW_MATCH		((uint8_t) 0x06)
+
+	#define SCORE_SETS				3
+	#define SCORE_HISTORY			16		// events that can be undone
+
+	// rendered table layout (same as "ScoreParams")
+	#define SCORE_TENS				0		// + 5 for player 2
+	#define SCORE_UNITS				1
+	#define SCORE_SET1				2
+	#define SCORE_FLAGS				10
+	#define SCORE_PLAYER2			5
+	#define SCORE_SERVER_MASK		((uint8_t) 0x03)
+	#define SCORE_BLANK				((uint8_t) 0x10)
+
+    //-----------------------------------
+	/** @brief Compact match state (also the resync payload).
+	 */
+	struct tsState{
+		uint8_t points[2];				//!< points in the current game (or tie-break)
+		uint8_t games[SCORE_SETS][2];	//!< games won in each set
+		uint8_t set;					//!< current set (0 to SCORE_SETS - 1)
+		uint8_t server;					//!< 0 = player 1, 1 = player 2
+		uint8_t flags;					//!< TS_TIEBREAK, TS_FINISHED, TS_TB_SERVER
+	};
+
+	#define TS_TIEBREAK				((uint8_t) 0x01)
+	#define TS_FINISHED				((uint8_t) 0x02)
+	#define TS_TB_SERVER			((uint8_t) 0x04)	// player 2 served first in the tie-break
+
+    //-----------------------------------
+    /** @brief Tennis score keeper\n
+     * Games go to 4 points with a 2 points lead (deuce and advantage), sets
+     * to 6 games with a 2 games lead and a 7 points tie-break at 6-6, the
+     * match to 2 sets. Points show as 0, 15, 30, 40 and "Ad" (hex A and D),
+     * tie-break points as numbers.
+     */
+    class TennisScore{
+
+        private:
+            tsState state;
+            tsState history[SCORE_HISTORY];
+            uint8_t history_head;
+            uint8_t history_size;
+
+            //-------------------------
+            void Push();
+            void Point(uint8_t);
+            void WinGame(uint8_t);
+            void NextSet();
+
+        public:
+            //-------------------------------------------
+            // METHODS
+            /**
+             * @brief Constructor for this component (new match, player 1 serving).
+             */
+            TennisScore();
+
+            /**
+             * @brief Applies one match event.
+             * @return false for unknown events or an undo with no history.
+             */
+            bool Apply(uint8_t);
+
+            /**
+             * @brief Replaces the whole state (resync); the undo history is cleared.
+             */
+            void Load(const tsState*);
+
+            /**
+             * @brief Writes the score into a "ScoreParams" table: points,
+             * games of each set and the server bits of the flags byte (other
+             * flags and the time fields are left untouched).
+             */
+            void Render(uint8_t*);
+
+            /**
+             * @brief Fletcher-16 checksum of the state, for divergence checks.
+             */
+            uint16_t Checksum();
+
+            //---------------------------------------
+            // PROPERTIES
+            /**
+             * @brief Current match state.
+             */
+            const tsState* State(){ return(&state);}
+    };
+
+#endif
+//==============================================================================
@@ -20,7 +20,12 @@
 //			   implemented Duty property in the NLed component. [V1.0.0-3]
 //------------------------------------------------------------------------------
 #include "Application.h"
-#include "FlipDisplay.h"
+#include "FlipDisplayFixed.h"
+#include "FirmwareUpdate.h"
+#include "Benchmark.h"
+#include "ServoSignature.h"
+#include "TennisScore.h"
+#include "MemoryStats.h"
 
 //------------------------------------------------------------------------------
 // NOTE: product ID, firmware version and publishing date
@@ -31,16 +36,21 @@ const uint8_t publishingDate[4]  	= {10,12,20,23};
 
 NLed* Led_Heartbeat;
 NTimer* Timer1;
+#ifdef BUS_NSERIAL
 NSerial* BusPort;
+#else
+BusUart* BusPort;
+#endif
 NTinyOutput* BusPort_DE;
 NTinyOutput* BusPort_RE;
 NDatagram* BUS_OutData;
 NDataLink* BUS_Link;
-NSerialProtocol* BUS_Interpret;
-NSerialCommand* busGetVersion;
-NSerialCommand* busGetStatus;
-NSerialCommand* busSetData;
-NSerialCommand* busSetServo;
+
+FirmwareUpdate* Updater;
+NTimer* UpdateTimer;
+NTimer* BaudTimer;
+NTimer* DiscoverTimer;
+NTimer* StandbyTimer;
 
 FlipDisplay* Digit;
 NTinyOutput* SegDrvH;
@@ -54,6 +64,11 @@ NTinyOutput* Segment_F;
 NTinyOutput* Segment_G;
 NTinyOutput* Segment_H;
 
+NAdc* CurrentSense;
+ServoSignature* Signature;
+volatile uint16_t CurrentSamples[SIGNATURE_SAMPLES];
+bool capturing = false;
+
 //------------------------------------------------------------------------------
 // data section
 #define SCORE_PARAMS_SIZE		14
@@ -73,6 +88,10 @@ NTinyOutput* Segment_H;
 #define PARAMS_HOURS			13
 uint8_t ScoreParams[SCORE_PARAMS_SIZE];
 
+TennisScore* Score;
+uint8_t ScoreSeq = SCORE_SEQ_NONE;
+bool ScoreDiverged = false;
+
 #define PARAMS_FLAGS_SERV_MASK		((uint8_t) 0x03)
 #define PARAMS_FLAGS_SERV_PLAY1		((uint8_t) 0x01)
 #define PARAMS_FLAGS_SERV_PLAY2		((uint8_t) 0x02)
@@ -87,13 +106,26 @@ uint8_t LocalAddress = 0;
 
 //------------------------------------------------------------------------------
 uint8_t LocalIndex = 255;
+uint8_t FrameCounter = 0;
 
 bool calibrating;
+bool calibration_started = false;
 uint8_t fsm_bus = FSM_IDLE;
 uint8_t fsm_counter = BUS_NODES;
 uint8_t test_counter = 0;
 
 float BatteryVoltage = 0.0;
+
+//------------------------------------------------------------------------------
+#define BAUD_STANDARD		0
+#define BAUD_SWITCHING		1
+#define BAUD_PROBATION		2
+#define BAUD_CONFIRMED		3
+
+uint8_t baud_state = BAUD_STANDARD;
+uint8_t BaudFactor = 1;
+uint8_t BaudPending = 1;
+uint16_t BaudStandardBRR = 0;
 //------------------------------------------------------------------------------
 const uint8_t NodeAddresses[BUS_NODES] = {
 		PLAY1_TENS, PLAY1_UNITS, PLAY1_SET1, PLAY1_SET2, PLAY1_SET3,
@@ -106,8 +138,20 @@ const uint16_t NodeDelay[BUS_NODES] = {
 		DELAY_TENS, DELAY_UNITS, DELAY_SET1, DELAY_SET2, DELAY_SET3
 };
 
+//------------------------------------------------------------------------------
+// node settings kept on the settings page (PROFILE, SIGNATURE)
+struct NodeConfig{
+	fdProfile profile;
+	uint8_t ramp[RAMP_PHASES];
+	ssFeatures baseline[SIGNATURE_PHASES];
+	uint8_t baselines;					// baseline[] saved (commissioned)
+};
+
+NodeConfig Config;
+
 //------------------------------------------------------------------------------
 void Timer1_OnTimer();
+void StartCalibration();
 void BusPort_OnPacket(uint8_t* data, uint8_t size);
 void BusPort_OnEnterTransmission();
 void BusPort_OnLeaveTransmission();
@@ -116,22 +160,119 @@ void busGetVersion_OnProcess(NDatagram*);
 void busGetStatus_OnProcess(NDatagram*);
 void busSetData_OnProcess(NDatagram*);
 void busSetServo_OnProcess(NDatagram*);
+void busSetMessage_OnProcess(NDatagram*);
+void busUpdateBegin_OnProcess(NDatagram*);
+void busUpdateBlock_OnProcess(NDatagram*);
+void busUpdateStatus_OnProcess(NDatagram*);
+void busUpdateApply_OnProcess(NDatagram*);
+void BusUpdateReply(NDatagram*, const uint8_t*, uint8_t);
+void UpdateTimer_OnTimer();
+void busSetBaud_OnProcess(NDatagram*);
+void busConfirmBaud_OnProcess(NDatagram*);
+void BaudTimer_OnTimer();
+void BusSetBaudFactor(uint8_t);
+void BusLinkAlive();
+uint16_t BaudSwitchDelay();
+uint16_t BusAirtime(uint8_t);
+uint16_t BusDispatchTime();
+void busDiscover_OnProcess(NDatagram*);
+void DiscoverTimer_OnTimer();
+void DiscoverFill(NDatagram*);
+uint8_t DiscoverSlot();
+void busBenchmark_OnProcess(NDatagram*);
+void BusLink_OnDatagram(NDatagram*);
+void BusEnable(uint8_t, bool);
+void Digit_OnMoveStart(uint8_t, uint8_t);
+void Digit_OnValueUpdate();
+void CurrentSense_OnDataBlock(uint16_t*, uint16_t);
+void busSignature_OnProcess(NDatagram*);
+void busStandby_OnProcess(NDatagram*);
+void StandbyTimer_OnTimer();
+void EnterStandby();
+void busProfile_OnProcess(NDatagram*);
+bool ConfigLoad(NodeConfig*);
+bool ConfigSave(const NodeConfig*);
+void ShowScoreParams();
+void ShowScore();
+void ScoreReply(NDatagram*);
+void busScoreEvent_OnProcess(NDatagram*);
+void busScoreSum_OnProcess(NDatagram*);
+void busMemory_OnProcess(NDatagram*);
 void AddressResolution();
 
+//------------------------------------------------------------------------------
+// PROSA COMMAND TABLE
+// Handlers indexed directly by command ID, built at compile time (flash
+// only). A command is served only while its bit in BusEnabled is set.
+//------------------------------------------------------------------------------
+typedef void (*BusHandler)(NDatagram*);
+
+struct BusCommandTable{
+	BusHandler handler[BUS_CMD_SLOTS];
+
+	constexpr BusCommandTable(): handler(){
+		handler[PROSA_CMD_VERSION]			= busGetVersion_OnProcess;
+		handler[PROSA_CMD_GETSTATUS]		= busGetStatus_OnProcess;
+		handler[PROSA_CMD_SETDATA]			= busSetData_OnProcess;
+		handler[PROSA_CMD_SETSERVO]			= busSetServo_OnProcess;
+		handler[PROSA_CMD_SETMESSAGE]		= busSetMessage_OnProcess;
+		handler[PROSA_CMD_UPDATE_BEGIN]		= busUpdateBegin_OnProcess;
+		handler[PROSA_CMD_UPDATE_BLOCK]		= busUpdateBlock_OnProcess;
+		handler[PROSA_CMD_UPDATE_STATUS]	= busUpdateStatus_OnProcess;
+		handler[PROSA_CMD_UPDATE_APPLY]		= busUpdateApply_OnProcess;
+		handler[PROSA_CMD_SETBAUD]			= busSetBaud_OnProcess;
+		handler[PROSA_CMD_CONFIRMBAUD]		= busConfirmBaud_OnProcess;
+		handler[PROSA_CMD_DISCOVER]			= busDiscover_OnProcess;
+		handler[PROSA_CMD_BENCHMARK]		= busBenchmark_OnProcess;
+		handler[PROSA_CMD_SIGNATURE]		= busSignature_OnProcess;
+		handler[PROSA_CMD_STANDBY]			= busStandby_OnProcess;
+		handler[PROSA_CMD_PROFILE]			= busProfile_OnProcess;
+		handler[PROSA_CMD_SCOREEVENT]		= busScoreEvent_OnProcess;
+		handler[PROSA_CMD_SCORESUM]			= busScoreSum_OnProcess;
+		handler[PROSA_CMD_MEMORY]			= busMemory_OnProcess;
+	}
+};
+
+static_assert((PROSA_CMD_VERSION < BUS_CMD_SLOTS) && (PROSA_CMD_GETSTATUS < BUS_CMD_SLOTS) &&
+			  (PROSA_CMD_SETDATA < BUS_CMD_SLOTS) && (PROSA_CMD_SETSERVO < BUS_CMD_SLOTS),
+			  "BUS_CMD_SLOTS must cover every PROSA command ID");
+
+// a wave must end (arrow and the longest ramp of every phase included)
+// before the next one starts
+static_assert(BOOT_WAVE_TIME > (2 * FSM_SERVOS_ON + FSM_SERVOS_CLEARING + FSM_SERVOS_MOVING_H +
+			  FSM_SERVOS_MOVING_V + 2 * FSM_SERVOS_OFF + FSM_SERVOS_ON + FSM_ARROW_MOVING +
+			  RAMP_PHASES * RAMP_FRAMES_MAX * PPM_FRAME_MAX_MS),
+			  "BOOT_WAVE_TIME shorter than a calibration move");
+static_assert(BOOT_WAVE_NODES > 0, "BOOT_SERVO_BUDGET below one node");
+static_assert(RAMP_DEFAULT <= RAMP_FRAMES_MAX, "RAMP_DEFAULT longer than RAMP_FRAMES_MAX");
+
+constexpr BusCommandTable BusCommands;
+uint32_t BusEnabled[(BUS_CMD_SLOTS + 31) / 32];
+
 //------------------------------------------------------------------------------
 void ApplicationCreate(){
 
+	// stack high-water mark: paint before anything else goes deep
+	MemPaint();
+
  	Led_Heartbeat = new NLed(LED);
 	Led_Heartbeat->Interval = 500;
 	Led_Heartbeat->Status = ldBlinking;
 
     //--------------------------------------------------------------------------
     // Bus communication components
-    BusPort = new NSerial(BUS_PORT); 			// Tx: PA9 Rx: PA10  DE: PA12  RE: PA11
+    // Tx: PA9 Rx: PA10  DE: PA12  RE: PA11
+#ifdef BUS_NSERIAL
+    BusPort = new NSerial(BUS_PORT);
+#else
+    BusPort = new BusUart(BUS_BAUD);			// DMA1 ch4 (Tx) / ch5 (Rx, circular)
+    BusPort->IrqPriority = IRQ_PRIORITY_BUS;
+#endif
     BusPort->OnPacket = BusPort_OnPacket;
     BusPort->OnEnterTransmission = BusPort_OnEnterTransmission;
     BusPort->OnLeaveTransmission = BusPort_OnLeaveTransmission;
     BusPort->Open();
+    BaudStandardBRR = (uint16_t) USART1->BRR;
 
     BUS_OutData = new NDatagram();
     BUS_OutData->Destination = PROSA_ADDR_BROADCAST;
@@ -139,29 +280,60 @@ void ApplicationCreate(){
     BUS_OutData->Command = PROSA_CMD_VERSION;
 
     BUS_Link = new NDataLink();
-    BUS_Link->TimeReload = 100;
-    BUS_Link->TimeDispatch = 40;
-    BUS_Link->Timeout = 25;
+    BUS_Link->TimeReload = BUS_TIME_RELOAD;
+    BUS_Link->TimeDispatch = BUS_TIME_DISPATCH;
+    BUS_Link->Timeout = BUS_TIMEOUT;
     BUS_Link->BusPrivilege = dlSlave;
     BUS_Link->ServiceAddress = PROSA_ADDR_SERVICE;
     BUS_Link->BroadcastAddress = PROSA_ADDR_BROADCAST;
     BUS_Link->OnPacketToSend = BusLink_OnPacketToSend;
+    BUS_Link->OnDatagram = BusLink_OnDatagram;
 
-    BUS_Interpret = new NSerialProtocol(BUS_Link);
+    // display commands (SETDATA, SETSERVO, SETMESSAGE and the score events) are
+    // enabled once this node's power-on calibration wave ends, see Timer1_OnTimer()
+    BusEnable(PROSA_CMD_VERSION, true);
+    BusEnable(PROSA_CMD_GETSTATUS, true);
+    BusEnable(PROSA_CMD_UPDATE_BEGIN, true);
+    BusEnable(PROSA_CMD_UPDATE_BLOCK, true);
+    BusEnable(PROSA_CMD_UPDATE_STATUS, true);
+    BusEnable(PROSA_CMD_UPDATE_APPLY, true);
+    BusEnable(PROSA_CMD_SETBAUD, true);
+    BusEnable(PROSA_CMD_CONFIRMBAUD, true);
+    BusEnable(PROSA_CMD_DISCOVER, true);
+    BusEnable(PROSA_CMD_BENCHMARK, true);
+    BusEnable(PROSA_CMD_SIGNATURE, true);
+    BusEnable(PROSA_CMD_STANDBY, true);
+    BusEnable(PROSA_CMD_PROFILE, true);
+    BusEnable(PROSA_CMD_MEMORY, true);
 
-    busGetVersion = new NSerialCommand(BUS_Interpret);
-    busGetVersion->ID = PROSA_CMD_VERSION;
-    busGetVersion->OnProcess = busGetVersion_OnProcess;
+    //--------------------------------------------------------------------------
+    // Firmware update over the bus
+    Updater = new FirmwareUpdate();
+    UpdateTimer = new NTimer();
+    UpdateTimer->OnTimer = UpdateTimer_OnTimer;
+
+    //--------------------------------------------------------------------------
+    // Bus rate negotiation
+    BaudTimer = new NTimer();
+    BaudTimer->OnTimer = BaudTimer_OnTimer;
+
+    //--------------------------------------------------------------------------
+    // Slotted discovery / health scan
+    DiscoverTimer = new NTimer();
+    DiscoverTimer->OnTimer = DiscoverTimer_OnTimer;
 
-    busGetStatus = new NSerialCommand(BUS_Interpret);
-    busGetStatus->ID = PROSA_CMD_GETSTATUS;
-    busGetStatus->OnProcess = busGetStatus_OnProcess;
+    //--------------------------------------------------------------------------
+    // On-node scoring from match events
+    Score = new TennisScore();
 
-    busSetData = new NSerialCommand(BUS_Interpret);
-    busSetData->ID = PROSA_CMD_SETDATA;
+    //--------------------------------------------------------------------------
+    // Low-power standby (idle timeout or STANDBY command), wake on bus activity
+    StandbyTimer = new NTimer();
+    StandbyTimer->OnTimer = StandbyTimer_OnTimer;
 
-    busSetServo = new NSerialCommand(BUS_Interpret);
-    busSetServo->ID = PROSA_CMD_SETSERVO;
+    //--------------------------------------------------------------------------
+    // Handler cycle counts and memory budget report
+    BenchReset();
 
     BusPort_DE = new NTinyOutput(USART1_RTS);
     BusPort_RE = new NTinyOutput(USART1_CTS);
@@ -171,7 +343,6 @@ void ApplicationCreate(){
     calibrating = true;
     Timer1 = new NTimer();
     Timer1->OnTimer = Timer1_OnTimer;
-    Timer1->Start(1000);
 
     SegDrvH = new NTinyOutput(DRV_HR);
     SegDrvV = new NTinyOutput(DRV_VR);
@@ -187,7 +358,24 @@ void ApplicationCreate(){
     Segment_F  = new NTinyOutput(SEGMENT_F);
     Segment_G  = new NTinyOutput(SEGMENT_G);
 
-    Digit = new FlipDisplay(TIMEBASE);
+    //------------------------------------------
+    AddressResolution();
+    //------------------------------------------
+
+    // every node runs the same image: tens nodes (serve arrow on segment H)
+    // and plain digit nodes each get a PPM tick compiled for their segments
+    if((LocalAddress == PLAY1_TENS)||(LocalAddress == PLAY2_TENS)){
+    	Digit = new FlipDisplayFixed<SEGMENT_PORT, SEGMENT_PIN0, 8>(TIMEBASE);
+    } else {
+    	Digit = new FlipDisplayFixed<SEGMENT_PORT, SEGMENT_PIN0, 7>(TIMEBASE);
+    }
+
+    // the PPM tick preempts the bus port: servo pulses keep their width while
+    // a frame is received (the USART holds a byte for a whole character time)
+    Digit->IrqPriority = IRQ_PRIORITY_PPM;
+#ifdef BUS_NSERIAL
+    NVIC_SetPriority(USART1_IRQn, IRQ_PRIORITY_BUS);
+#endif
     Digit->Driver_H = SegDrvH;
     Digit->Driver_V = SegDrvV;
     Digit->Segment[0] = Segment_A;
@@ -198,52 +386,98 @@ void ApplicationCreate(){
     Digit->Segment[5] = Segment_F;
     Digit->Segment[6] = Segment_G;
 
-    //------------------------------------------
-    AddressResolution();
-    //------------------------------------------
+    // servo profile and motion ramps saved by PROFILE (standard analog
+    // servos and RAMP_DEFAULT otherwise)
+    Config.profile = Digit->Profile();
+    for(int r=0; r<RAMP_PHASES; r++){ Config.ramp[r] = RAMP_DEFAULT;}
+    Config.baselines = 0;
+    ConfigLoad(&Config);
+    Digit->SetProfile(Config.profile);
+    for(int r=0; r<RAMP_PHASES; r++){ Digit->Ramp[r] = Config.ramp[r];}
 
+    //--------------------------------------------------------------------------
+    // Servo current signatures (built-in test): one DMA block per move phase
+    Signature = new ServoSignature();
+    // saved baselines: a servo already dead at power-on is not learned as normal
+    if(Config.baselines){ Signature->Load(Config.baseline);}
+    CurrentSense = new NAdc(ADC1);
+    CurrentSense->AddChannel(CURRENT_SENSE);
+    CurrentSense->Mode = adContinuous3;
+    CurrentSense->SetDataBuffer((uint16_t*)CurrentSamples, SIGNATURE_SAMPLES);
+    CurrentSense->OnDataBlock = CurrentSense_OnDataBlock;
+    Digit->OnMoveStart = Digit_OnMoveStart;
+    Digit->OnValueUpdate = Digit_OnValueUpdate;
 
     if((LocalAddress == PLAY1_TENS)||(LocalAddress == PLAY2_TENS)){
     	Segment_H  = new NTinyOutput(SEGMENT_H);
     	Digit->Segment[Seg_H] = Segment_H;
     }
 
-    if(LocalIndex < BUS_NODES){
-    	Digit->Delay = NodeDelay[LocalIndex];
-    }
-
     BUS_Link->LocalAddress = LocalAddress;
     BUS_Link->Open();
 
-    DebugParams[PARAM_DUTY] = PPM_SEG_CALIBRATE;
-    DebugParams[PARAM_SEGMENTS] = SERVOS_DIGIT | SERVOS_ARROW;
-    Digit->DebugServo(DebugParams);
+    //------------------------------------------
+    // power-on calibration: nodes of the same wave start together, with no
+    // "Delay" (the supply budget is already accounted for by the wave)
+    uint8_t wave = (BUS_NODES - 1) / BOOT_WAVE_NODES;
+    if(LocalIndex < BUS_NODES){ wave = LocalIndex / BOOT_WAVE_NODES;}
+
+    if(wave == 0){
+    	StartCalibration();
+    } else {
+    	Timer1->Start((uint32_t) wave * BOOT_WAVE_TIME);
+    }
+}
+
+//------------------------------------------------------------------------------
+void StartCalibration(){
+	calibration_started = true;
+	DebugParams[PARAM_DUTY] = PPM_SEG_CALIBRATE;
+	DebugParams[PARAM_SEGMENTS] = SERVOS_DIGIT | SERVOS_ARROW;
+	Digit->DebugServo(DebugParams);
+	Timer1->Start(BOOT_POLL);
 }
 
 //------------------------------------------------------------------------------
+// Power-on calibration: start of this node's wave, then end of its moves.
 void Timer1_OnTimer(){
-	if(calibrating){
-		Timer1->Stop();
+	Timer1->Stop();
+	if(!calibrating){ return;}
+
+	if(!calibration_started){
+		StartCalibration();
+	} else if(Digit->Busy()){
+		Timer1->Start(BOOT_POLL);
+	} else {
 		calibrating = false;
-	    busSetData->OnProcess = busSetData_OnProcess;
-	    busSetServo->OnProcess = busSetServo_OnProcess;
+		if(LocalIndex < BUS_NODES){ Digit->Delay = NodeDelay[LocalIndex];}
+		BusEnable(PROSA_CMD_SETDATA, true);
+		BusEnable(PROSA_CMD_SETSERVO, true);
+		BusEnable(PROSA_CMD_SETMESSAGE, true);
+		BusEnable(PROSA_CMD_SCOREEVENT, true);
+		BusEnable(PROSA_CMD_SCORESUM, true);
+		StandbyTimer->Start(STANDBY_IDLE_TIME);
 	}
 }
 
 //------------------------------------------------------------------------------
+// DE and RE share GPIOA: one BSRR / BRR write turns the transceiver around
+// (BusPort_DE and BusPort_RE only configure the pins).
 void BusPort_OnEnterTransmission(){
-	BusPort_RE->Level = toHigh; BusPort_DE->Level = toHigh;
+	BUS_DIR_PORT->BSRR = BUS_DIR_MASK;
 }
 
 //------------------------------------------------------------------------------
 void BusPort_OnLeaveTransmission(){
-	BusPort_DE->Level = toLow; BusPort_RE->Level = toLow;
+	BUS_DIR_PORT->BRR = BUS_DIR_MASK;
 }
 
 
 //------------------------------------------------------------------------------
 void BusPort_OnPacket(uint8_t* data, uint8_t size){
+	BENCH_BEGIN(BENCH_BUS_PACKET);
 	BUS_Link->ProcessPacket(data, size);
+	BENCH_END(BENCH_BUS_PACKET);
 }
 
 //------------------------------------------------------------------------------
@@ -251,6 +485,33 @@ void BusLink_OnPacketToSend(uint8_t* data, uint8_t size){
 	BusPort->Write(data, size);
 }
 
+//------------------------------------------------------------------------------
+// Valid datagram for this node (or broadcast): one table lookup, one call.
+// Broadcasts are processed but never answered.
+void BusLink_OnDatagram(NDatagram* iDt){
+	uint8_t id = iDt->Command;
+	bool answer = (iDt->Destination != PROSA_ADDR_BROADCAST);
+
+	// any valid datagram proves the link, served here or not (after
+	// CONFIRMBAUD, restarts the watchdog)
+	BusLinkAlive();
+
+	if(id >= BUS_CMD_SLOTS){ return;}
+	if(!(BusEnabled[id >> 5] & (0x01UL << (id & 0x1F)))){ return;}
+	if(BusCommands.handler[id] == NULL){ return;}
+
+	MemSample();
+	BusCommands.handler[id](iDt);
+	if(answer){ BUS_Link->Send(iDt);}
+}
+
+//------------------------------------------------------------------------------
+void BusEnable(uint8_t id, bool enabled){
+	if(id >= BUS_CMD_SLOTS){ return;}
+	if(enabled){ BusEnabled[id >> 5] |= (0x01UL << (id & 0x1F));}
+	else { BusEnabled[id >> 5] &= ~(0x01UL << (id & 0x1F));}
+}
+
 //------------------------------------------------------------------------------
 // BUS PROTOCOL
 //------------------------------------------------------------------------------
@@ -264,7 +525,6 @@ void busGetVersion_OnProcess(NDatagram* iDt){
 
 //------------------------------------------------------------------------------
 void busGetStatus_OnProcess(NDatagram* iDt){
-
 	if((iDt->Length > 0) && (iDt->Extract() == 0x01)){
 		AddressResolution();
 	}
@@ -284,6 +544,19 @@ void busSetData_OnProcess(NDatagram* iDt){
 		//result = true;
 	}
 
+	ShowScoreParams();
+
+	StandbyTimer->Start(STANDBY_IDLE_TIME);
+	iDt->SwapAddresses();
+	iDt->Flush();
+	iDt->Append(LocalAddress);
+	iDt->Append(myBITE);
+	iDt->UpdateCrc();
+}
+
+//------------------------------------------------------------------------------
+// Shows this node's entry of "ScoreParams" (and the serve arrow on tens nodes)
+void ShowScoreParams(){
 	if(LocalIndex <= BUS_NODES){
 		Digit->Value = ScoreParams[LocalIndex];
 
@@ -304,12 +577,6 @@ void busSetData_OnProcess(NDatagram* iDt){
 			Led_Heartbeat->Duty = 50; 				// %
 		}
 	}
-
-	iDt->SwapAddresses();
-	iDt->Flush();
-	iDt->Append(LocalAddress);
-	iDt->Append(myBITE);
-	iDt->UpdateCrc();
 }
 
 //------------------------------------------------------------------------------
@@ -325,6 +592,7 @@ void busSetServo_OnProcess(NDatagram* iDt){
 		Digit->DebugServo(DebugParams);
 	}
 
+	StandbyTimer->Start(STANDBY_IDLE_TIME);
 	iDt->SwapAddresses();
 	iDt->Flush();
 	iDt->Append(LocalAddress);
@@ -332,6 +600,738 @@ void busSetServo_OnProcess(NDatagram* iDt){
 	iDt->UpdateCrc();
 }
 
+//------------------------------------------------------------------------------
+// Show a message across the board (usually broadcast)
+// | dst | src | len | cmd | c0 | c1 | ... | cn | crc | crc |
+// cx: character for the node at LocalIndex "x". ASCII characters (0x20..0x7F)
+//     are shown through the glyph table; with bit 7 set, bits 0..6 are a raw
+//     segments bitmask (A..G).
+void busSetMessage_OnProcess(NDatagram* iDt){
+	uint8_t message[BUS_NODES];
+	uint8_t size = iDt->Length;
+
+	if((size > 0) && (size <= BUS_NODES)){
+		iDt->Extract(message, size);
+		if(LocalIndex < size){
+			if(message[LocalIndex] & 0x80){ Digit->Pattern = message[LocalIndex];}
+			else { Digit->Glyph = (char) message[LocalIndex];}
+		}
+	}
+
+	StandbyTimer->Start(STANDBY_IDLE_TIME);
+	iDt->SwapAddresses();
+	iDt->Flush();
+	iDt->Append(LocalAddress);
+	iDt->Append(myBITE);
+	iDt->UpdateCrc();
+}
+
+//------------------------------------------------------------------------------
+// FIRMWARE UPDATE
+// 1. UPDATE_BEGIN (broadcast): all nodes erase their staging slot
+// 2. UPDATE_BLOCK (broadcast): the image is sent once, block by block
+// 3. UPDATE_STATUS (per node): each node reports its missing blocks bitmap;
+//    the controller retransmits only the missing blocks, then repeats 3.
+// 4. UPDATE_APPLY (broadcast): nodes check the image CRC and, if valid,
+//    tag it and restart; the boot stage copies it over the running firmware
+//    (again after a power loss) before starting it.
+// The image is slot A only: the .bin from offset 0x400 (after the boot page).
+//------------------------------------------------------------------------------
+// The payloads are handled by FirmwareUpdate (OnBegin, OnBlock, OnStatus,
+// OnApply); every reply is | addr | payload |.
+// UPDATE_BEGIN and UPDATE_BLOCK are refused (state fuBusy) while the digit
+// moves or calibrates: erasing and programming stall the CPU, and with it the
+// PPM tick. A refused block stays missing and is sent again after step 3.
+//------------------------------------------------------------------------------
+void BusUpdateReply(NDatagram* iDt, const uint8_t* reply, uint8_t length){
+	iDt->SwapAddresses();
+	iDt->Flush();
+	iDt->Append(LocalAddress);
+	for(int c=0; c<length; c++){ iDt->Append(reply[c]);}
+	iDt->UpdateCrc();
+}
+
+//------------------------------------------------------------------------------
+// | dst | src | len | cmd | size (4 bytes) | crc32 (4 bytes) | crc | crc |
+void busUpdateBegin_OnProcess(NDatagram* iDt){
+	uint8_t request[8];
+	uint8_t reply[UPDATE_REPLY_MAX];
+	uint8_t size = iDt->Length;
+
+	if(size == sizeof(request)){ iDt->Extract(request, size);}
+	BusUpdateReply(iDt, reply, Updater->OnBegin(request, size, calibrating || Digit->Busy(), reply));
+}
+
+//------------------------------------------------------------------------------
+// | dst | src | len | cmd | index (2 bytes) | data (up to 32 bytes) | crc | crc |
+void busUpdateBlock_OnProcess(NDatagram* iDt){
+	uint8_t request[UPDATE_BLOCK_SIZE + 2];
+	uint8_t reply[UPDATE_REPLY_MAX];
+	uint8_t size = iDt->Length;
+
+	if(size > sizeof(request)){ size = 0;}
+	if(size > 0){ iDt->Extract(request, size);}
+	BusUpdateReply(iDt, reply, Updater->OnBlock(request, size, calibrating || Digit->Busy(), reply));
+}
+
+//------------------------------------------------------------------------------
+// | dst | src | len | cmd | offset | crc | crc |
+void busUpdateStatus_OnProcess(NDatagram* iDt){
+	uint8_t request[1];
+	uint8_t reply[UPDATE_REPLY_MAX];
+	uint8_t size = 0;
+
+	if(iDt->Length > 0){ request[0] = iDt->Extract(); size = 1;}
+	BusUpdateReply(iDt, reply, Updater->OnStatus(request, size, reply));
+}
+
+//------------------------------------------------------------------------------
+void busUpdateApply_OnProcess(NDatagram* iDt){
+	uint8_t reply[UPDATE_REPLY_MAX];
+	uint8_t length = Updater->OnApply(reply);
+
+	if(Updater->State() == fuVerified){
+		Digit->Enabled = false;
+		UpdateTimer->Start(UPDATE_APPLY_DELAY);
+	}
+	BusUpdateReply(iDt, reply, length);
+}
+
+//------------------------------------------------------------------------------
+void UpdateTimer_OnTimer(){
+	UpdateTimer->Stop();
+	if(SegDrvH != NULL){ SegDrvH->Level = toLow;}
+	if(SegDrvV != NULL){ SegDrvV->Level = toLow;}
+	Updater->Apply();
+}
+
+//------------------------------------------------------------------------------
+// BUS RATE NEGOTIATION
+// 1. SETBAUD (broadcast, standard rate): | factor | (1, 2, 4 or 8)
+//    like every broadcast it is not answered; nodes switch to "factor" times
+//    the standard rate after BaudSwitchDelay(). Sent to a single node it is
+//    answered with the node's current factor (| addr | factor |), and the
+//    delay lets that reply go out at the old rate.
+// 2. CONFIRMBAUD (broadcast, new rate): must arrive within
+//    BAUD_CONFIRM_TIMEOUT, otherwise the node goes back to the standard rate.
+// Once confirmed, BAUD_LINK_TIMEOUT of bus silence also sends the node back
+// to the standard rate, so a controller that lost the nodes simply starts
+// over at the standard rate.
+//------------------------------------------------------------------------------
+void busSetBaud_OnProcess(NDatagram* iDt){
+
+	if(iDt->Length == 1){
+		uint8_t factor = iDt->Extract();
+		if((factor == 1)||(factor == 2)||(factor == 4)||(factor == BAUD_FACTOR_MAX)){
+			BaudPending = factor;
+			baud_state = BAUD_SWITCHING;
+			BaudTimer->Start(BaudSwitchDelay());
+		}
+	}
+
+	iDt->SwapAddresses();
+	iDt->Flush();
+	iDt->Append(LocalAddress);
+	iDt->Append(BaudFactor);
+	iDt->UpdateCrc();
+}
+
+//------------------------------------------------------------------------------
+void busConfirmBaud_OnProcess(NDatagram* iDt){
+
+	if(baud_state == BAUD_PROBATION){ baud_state = BAUD_CONFIRMED;}
+
+	iDt->SwapAddresses();
+	iDt->Flush();
+	iDt->Append(LocalAddress);
+	iDt->Append(BaudFactor);
+	iDt->UpdateCrc();
+}
+
+//------------------------------------------------------------------------------
+void BaudTimer_OnTimer(){
+	BaudTimer->Stop();
+
+	if(baud_state == BAUD_SWITCHING){
+		BusSetBaudFactor(BaudPending);
+		if(BaudFactor == 1){ baud_state = BAUD_STANDARD;}
+		else {
+			baud_state = BAUD_PROBATION;
+			BaudTimer->Start(BAUD_CONFIRM_TIMEOUT);
+		}
+	} else {
+		// no confirmation or bus silent for too long
+		BusSetBaudFactor(1);
+		baud_state = BAUD_STANDARD;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Time (ms) from SETBAUD to the rate switch: the SETBAUD reply waits up to the
+// link dispatch delay before it goes out, then takes its airtime; BRR must
+// not change before it is done
+uint16_t BaudSwitchDelay(){
+	return(BusDispatchTime() + BusAirtime(BAUD_REPLY_BYTES) + BAUD_SWITCH_GUARD);
+}
+
+//------------------------------------------------------------------------------
+// Restarts the link watchdog while running above the standard rate
+void BusLinkAlive(){
+	if(baud_state == BAUD_CONFIRMED){ BaudTimer->Start(BAUD_LINK_TIMEOUT);}
+}
+
+//------------------------------------------------------------------------------
+void BusSetBaudFactor(uint8_t factor){
+	uint16_t time;
+
+	// let the current frame finish before changing the rate
+#ifndef BUS_NSERIAL
+	while(BusPort->Busy()){}
+#endif
+	while(!(USART1->SR & USART_SR_TC)){}
+	USART1->CR1 &= ~USART_CR1_UE;
+	USART1->BRR = BaudStandardBRR / factor;
+	USART1->CR1 |= USART_CR1_UE;
+	BaudFactor = factor;
+
+	// frames get shorter by "factor"; keep the link timing proportional
+	time = BUS_TIME_RELOAD / factor; if(time < BUS_TIME_MIN){ time = BUS_TIME_MIN;}
+	BUS_Link->TimeReload = time;
+	BUS_Link->TimeDispatch = BusDispatchTime();
+	time = BUS_TIMEOUT / factor; if(time < BUS_TIME_MIN){ time = BUS_TIME_MIN;}
+	BUS_Link->Timeout = time;
+}
+
+//------------------------------------------------------------------------------
+// DISCOVERY / HEALTH SCAN
+// | dst | src | len | cmd | slot (optional, ms) | crc | crc |
+// Sent as broadcast; every node answers on its own time slot:
+//   DISCOVER_GUARD + LocalIndex * slot (nodes with an unknown address use
+//   the slot after the last node), so the whole board reports in
+//   (BUS_NODES + 1) * slot ms with no collisions. A slot shorter than
+//   DiscoverSlot() (reply airtime plus the link dispatch delay) is widened.
+// Sent to one node, the answer goes back at once like any other command.
+// answer: | addr | bite | version (4 bytes) | frame counter | pattern | flags |
+//   frame counter: display frames (SETDATA, SETMESSAGE, SCOREEVENT) this
+//   digit has shown, see Digit_OnValueUpdate(); a frame that is overtaken
+//   while the digit moves is shown only through the one after it.
+//   pattern: segments on display (or being moved to), whatever set them.
+//------------------------------------------------------------------------------
+void busDiscover_OnProcess(NDatagram* iDt){
+	uint8_t slot = 0;
+	uint8_t index = LocalIndex;
+
+	if(iDt->Destination != PROSA_ADDR_BROADCAST){
+		iDt->SwapAddresses();
+		DiscoverFill(iDt);
+		return;
+	}
+
+	if(iDt->Length > 0){ slot = iDt->Extract();}
+	if(slot < DiscoverSlot()){ slot = DiscoverSlot();}
+	if(index >= BUS_NODES){ index = BUS_NODES;}
+
+	BUS_OutData->Destination = iDt->Source;
+	DiscoverTimer->Start(DISCOVER_GUARD + (uint16_t) index * slot);
+}
+
+//------------------------------------------------------------------------------
+void DiscoverTimer_OnTimer(){
+	DiscoverTimer->Stop();
+
+	BUS_OutData->Source = LocalAddress;
+	BUS_OutData->Command = PROSA_CMD_DISCOVER;
+	DiscoverFill(BUS_OutData);
+	BUS_Link->Send(BUS_OutData);
+}
+
+//------------------------------------------------------------------------------
+void DiscoverFill(NDatagram* iDt){
+	uint8_t flags = 0;
+
+	if(calibrating){ flags |= PARAMS_FLAGS_CALIBRATING;}
+	if(ScoreParams[PARAMS_FLAGS] & PARAMS_FLAGS_CONNECTED){ flags |= PARAMS_FLAGS_CONNECTED;}
+
+	iDt->Flush();
+	iDt->Append(LocalAddress);
+	iDt->Append(myBITE);
+	iDt->Append(*(uint32_t*) firmwareVersion);
+	iDt->Append(FrameCounter);
+	iDt->Append((uint8_t) Digit->Pattern);
+	iDt->Append(flags);
+	iDt->UpdateCrc();
+}
+
+//------------------------------------------------------------------------------
+// Shortest collision-free slot (ms) at the current rate: the reply airtime
+// plus the link dispatch delay, which a queued reply may wait before it goes
+// out, plus one tick of timer jitter
+uint8_t DiscoverSlot(){
+	uint32_t slot = BusAirtime(DISCOVER_REPLY_BYTES) + BusDispatchTime() + 1;
+
+	if(slot < DISCOVER_SLOT){ slot = DISCOVER_SLOT;}
+	if(slot > 0xFF){ slot = 0xFF;}
+	return (uint8_t) slot;
+}
+
+//------------------------------------------------------------------------------
+// Airtime (ms, rounded up) of "bytes" at the current rate, 10 bits per byte
+uint16_t BusAirtime(uint8_t bytes){
+	uint32_t pclk2 = SystemCoreClock;
+	uint32_t ppre2 = (RCC->CFGR & RCC_CFGR_PPRE2) >> RCC_CFGR_PPRE2_Pos;
+
+	if(ppre2 & 0x04){ pclk2 >>= (ppre2 & 0x03) + 1;}
+	// BRR = fPCLK2 / baud with 16x oversampling
+	return (uint16_t)(((uint32_t) bytes * 10UL * 1000UL * USART1->BRR + pclk2 - 1) / pclk2);
+}
+
+//------------------------------------------------------------------------------
+// Link dispatch delay (ms) at the current rate, see BusSetBaudFactor()
+uint16_t BusDispatchTime(){
+	uint16_t time = BUS_TIME_DISPATCH / BaudFactor;
+	if(time < BUS_TIME_MIN){ time = BUS_TIME_MIN;}
+	return(time);
+}
+
+//------------------------------------------------------------------------------
+// BENCHMARK (release checks)
+// | dst | src | len | cmd | probe | crc | crc |
+// probe < BENCH_PROBES:
+//   reply: | probe | min | avg | max | count | load | (4 bytes each, cycles,
+//   load in per mille: of the time the digit was moving for the PPM tick,
+//   of all cycles since the last reset for the bus packet)
+// probe = 0xFE: reset every probe (and the load window)
+// probe = 0xFF: memory budget
+//   reply: | 0xFF | flash used | flash size | ram used | ram size | (4 bytes each)
+//   ram used = .data + .bss + minimum heap + minimum stack
+// Probes only count when built with BENCHMARK_ENABLED (see Benchmark.h).
+// Tests/bench_run.py plays a scripted match and collects this report, MEMORY
+// and the ELF section sizes into a text file that can be diffed between builds.
+//------------------------------------------------------------------------------
+extern "C" uint32_t _sidata, _sdata, _edata, _ebss, _estack;
+extern "C" uint32_t _slot_a_start, _slot_a_size, _Min_Heap_Size, _Min_Stack_Size;
+
+void busBenchmark_OnProcess(NDatagram* iDt){
+	uint32_t result[5];
+	uint8_t probe = 0xFF;
+
+	if(iDt->Length > 0){ probe = iDt->Extract();}
+
+	iDt->SwapAddresses();
+	iDt->Flush();
+	iDt->Append(probe);
+
+	if(probe < BENCH_PROBES){
+		BenchRead(probe, result);
+		for(int c=0; c<5; c++){ iDt->Append(result[c]);}
+	} else if(probe == 0xFE){
+		BenchReset();
+	} else {
+		uint32_t data_size = (uint32_t) &_edata - (uint32_t) &_sdata;
+		iDt->Append((uint32_t) &_sidata - (uint32_t) &_slot_a_start + data_size);
+		iDt->Append((uint32_t) &_slot_a_size);
+		iDt->Append((uint32_t) &_ebss - (uint32_t) &_sdata +
+				(uint32_t) &_Min_Heap_Size + (uint32_t) &_Min_Stack_Size);
+		iDt->Append((uint32_t) &_estack - (uint32_t) &_sdata);
+	}
+	iDt->UpdateCrc();
+}
+
+//------------------------------------------------------------------------------
+// A display frame reached the digit (move over, or nothing to move); counted
+// for DISCOVER. Calibration moves are not frames.
+void Digit_OnValueUpdate(){
+	if(!calibrating){ FrameCounter++;}
+}
+
+//------------------------------------------------------------------------------
+// Servo current signatures: the capture starts with each move phase. Calibration
+// moves (unknown starting position) are not captured, and a phase starting
+// while the previous capture is still running is skipped.
+// The SIGNATURE_SAMPLES are spread over SIGNATURE_COVER / 8 of the phase, so
+// the capture sees the whole move and is over before the next phase starts
+// (the clear phase runs straight into the H phase).
+void Digit_OnMoveStart(uint8_t phase, uint8_t segments){
+	if(calibrating || capturing || (segments == 0)){ return;}
+	uint32_t interval = ((uint32_t) Digit->PhaseLength() * 1000UL * SIGNATURE_COVER) /
+			(8UL * SIGNATURE_SAMPLES);
+	if(interval < SIGNATURE_INTERVAL_MIN){ interval = SIGNATURE_INTERVAL_MIN;}
+
+	capturing = true;
+	Signature->Begin(phase, segments);
+	CurrentSense->Start(interval);
+}
+
+//------------------------------------------------------------------------------
+void CurrentSense_OnDataBlock(uint16_t* data, uint16_t size){
+	MemSample();
+	CurrentSense->Stop();
+	myBITE |= Signature->Process(data, size);
+	capturing = false;
+}
+
+//------------------------------------------------------------------------------
+// SIGNATURE (built-in test)
+// | dst | src | len | cmd | phase | crc | crc |
+// phase < SIGNATURE_PHASES (RAMP_CLEAR, RAMP_H, RAMP_V, RAMP_ARROW):
+//   reply: | addr | phase | learned | last: peak (2) energy (2) settle |
+//          baseline: peak (2) energy (2) settle | faults |
+// phase = 0xFE: clears the faults (and myBITE), baselines are kept
+//   reply: | addr | 0xFE | faults |
+// phase = 0xFD: saves the learned baselines to the settings page (commissioning,
+//   with servos known to be good); they are used from the next power-on
+// phase = 0xFC: forgets the baselines (saved ones too), the node learns again
+//   reply: | addr | 0xFD or 0xFC | result | faults |
+//   result: 0 = ok, 1 = rejected (moving, or not every phase learned), 2 = not saved
+// Features are per moving servo: peak and energy in ADC counts, settle in samples.
+//------------------------------------------------------------------------------
+void busSignature_OnProcess(NDatagram* iDt){
+	uint8_t phase = 0;
+	uint8_t result = 0;
+
+	if(iDt->Length > 0){ phase = iDt->Extract();}
+	if(phase == 0xFE){
+		Signature->ClearFaults();
+		myBITE = 0;
+	} else if((phase == 0xFD) || (phase == 0xFC)){
+		if(Digit->Busy() || capturing || ((phase == 0xFD) && !Signature->Complete())){
+			result = 1;
+		} else {
+			if(phase == 0xFD){
+				for(int p=0; p<SIGNATURE_PHASES; p++){ Config.baseline[p] = Signature->Baseline[p];}
+				Config.baselines = 1;
+			} else {
+				Signature->Forget();
+				Config.baselines = 0;
+			}
+			if(!ConfigSave(&Config)){ result = 2;}
+		}
+	}
+
+	iDt->SwapAddresses();
+	iDt->Flush();
+	iDt->Append(LocalAddress);
+	iDt->Append(phase);
+	if((phase == 0xFD) || (phase == 0xFC)){ iDt->Append(result);}
+	if(phase < SIGNATURE_PHASES){
+		ssFeatures* f[2] = { &Signature->Last[phase], &Signature->Baseline[phase] };
+		iDt->Append(Signature->Learned[phase]);
+		for(int k=0; k<2; k++){
+			iDt->Append((uint8_t)(f[k]->peak & 0xFF));
+			iDt->Append((uint8_t)(f[k]->peak >> 8));
+			iDt->Append((uint8_t)(f[k]->energy & 0xFF));
+			iDt->Append((uint8_t)(f[k]->energy >> 8));
+			iDt->Append(f[k]->settle);
+		}
+	}
+	iDt->Append(Signature->Faults);
+	iDt->UpdateCrc();
+}
+
+//------------------------------------------------------------------------------
+// STANDBY (usually broadcast)
+// | dst | src | len | cmd | crc | crc |
+// reply: | addr |
+// The node enters Stop mode STANDBY_ENTER_DELAY later (or as soon as the digit
+// is idle) and wakes on the first falling edge on the bus (USART1 RX, PA10).
+// That character is lost while the clocks restart, so the controller sends a
+// wake preamble (one 0x00 byte, broadcast) and waits STANDBY_WAKE_TIME before
+// the first datagram, well within BUS_TIMEOUT.
+//------------------------------------------------------------------------------
+void busStandby_OnProcess(NDatagram* iDt){
+	StandbyTimer->Start(STANDBY_ENTER_DELAY);
+
+	iDt->SwapAddresses();
+	iDt->Flush();
+	iDt->Append(LocalAddress);
+	iDt->UpdateCrc();
+}
+
+//------------------------------------------------------------------------------
+void StandbyTimer_OnTimer(){
+	StandbyTimer->Stop();
+
+	// never stop in the middle of a move, a calibration or a firmware update
+	if(calibrating || Digit->Busy() || (Updater->State() == fuReceiving)){
+		StandbyTimer->Start(STANDBY_RETRY);
+		return;
+	}
+
+	EnterStandby();
+	StandbyTimer->Start(STANDBY_IDLE_TIME);
+}
+
+//------------------------------------------------------------------------------
+// Servo lines off, clock down to HSI, Stop mode (regulator in low power) until
+// a falling edge on PA10. The EXTI line is set in event mode and the core waits
+// with WFE, so no interrupt handler is needed; the line is also unmasked (its
+// NVIC channel stays disabled) only so that the edge latches EXTI->PR, which
+// tells a bus wake from any other event. After Stop the core runs from HSI:
+// the oscillators that were running before (RCC->CR) are restarted and the
+// original source selected again (PLL settings in RCC->CFGR are kept through
+// Stop). A crystal that does not restart resets the node.
+void EnterStandby(){
+	uint32_t cfgr = RCC->CFGR;
+	uint32_t cr = RCC->CR;
+	uint32_t timeout;
+
+	SegDrvH->Level = toLow;
+	SegDrvV->Level = toLow;
+	for(int c=0; c<8; c++){
+		if(Digit->Segment[c] != NULL){ Digit->Segment[c]->Level = toLow;}
+	}
+	Led_Heartbeat->Status = ldOff;
+
+	// receiver stays enabled (RE low), driver off
+	BusPort_DE->Level = toLow;
+	BusPort_RE->Level = toLow;
+
+	// wake source: falling edge on PA10 (start bit), EXTI line 10
+	NVIC_DisableIRQ(EXTI15_10_IRQn);
+	AFIO->EXTICR[2] = (AFIO->EXTICR[2] & ~AFIO_EXTICR3_EXTI10) | AFIO_EXTICR3_EXTI10_PA;
+	EXTI->RTSR &= ~EXTI_RTSR_TR10;
+	EXTI->FTSR |= EXTI_FTSR_TR10;
+	EXTI->IMR |= EXTI_IMR_MR10;
+	EXTI->PR = EXTI_PR_PR10;
+	EXTI->EMR |= EXTI_EMR_MR10;
+
+	// drop the system clock to HSI before stopping HSE and PLL
+	RCC->CFGR = (RCC->CFGR & ~RCC_CFGR_SW) | RCC_CFGR_SW_HSI;
+	while((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_HSI){}
+	RCC->CR &= ~(RCC_CR_PLLON | RCC_CR_HSEON);
+
+	RCC->APB1ENR |= RCC_APB1ENR_PWREN;
+	PWR->CR &= ~PWR_CR_PDDS;
+	PWR->CR |= PWR_CR_LPDS;
+	SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+
+	__SEV(); __WFE();		// clears the event register
+	// Stop mode, back to sleep on any event that is not the bus edge
+	while(!(EXTI->PR & EXTI_PR_PR10)){ __WFE();}
+
+	SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+	EXTI->EMR &= ~EXTI_EMR_MR10;
+	EXTI->IMR &= ~EXTI_IMR_MR10;
+	EXTI->PR = EXTI_PR_PR10;
+
+	// clock back: only the oscillators that were on, then the original bus
+	// prescalers and source
+	if(cr & RCC_CR_HSEON){
+		RCC->CR |= RCC_CR_HSEON;
+		for(timeout = STANDBY_HSE_TIMEOUT; !(RCC->CR & RCC_CR_HSERDY); timeout--){
+			if(timeout == 0){ NVIC_SystemReset();}
+		}
+	}
+	if(cr & RCC_CR_PLLON){
+		RCC->CR |= RCC_CR_PLLON;
+		while(!(RCC->CR & RCC_CR_PLLRDY)){}
+	}
+	RCC->CFGR = cfgr;
+	while((RCC->CFGR & RCC_CFGR_SWS) != ((cfgr & RCC_CFGR_SW) << 2)){}
+
+	Led_Heartbeat->Status = ldBlinking;
+}
+
+//------------------------------------------------------------------------------
+// SCOREEVENT (usually broadcast)
+// | dst | src | len | cmd | seq | event | crc | crc |
+//   event: SCORE_EV_* (see TennisScore.h), applied to the local copy of the
+//   score. The controller numbers events 0, 1, 2... from the NEW_MATCH that
+//   opens a match (seq 0), wrapping after 255. A repeated seq is ignored and
+//   a skipped one marks the node as diverged (it still applies the event).
+//   NEW_MATCH is always taken and restarts the numbering from its own seq;
+//   after reset the node holds SCORE_SEQ_NONE, so event 0 is never dropped.
+// | dst | src | len | cmd | seq | state | crc | crc |
+//   state: tsState, replaces the local score (resync, clears "diverged")
+// reply (addressed only): | addr | seq | checksum (2 bytes) | diverged |
+//------------------------------------------------------------------------------
+void busScoreEvent_OnProcess(NDatagram* iDt){
+	uint8_t size = iDt->Length;
+
+	if(size == 2){
+		uint8_t seq = iDt->Extract();
+		uint8_t event = iDt->Extract();
+		if(event == SCORE_EV_NEW_MATCH){
+			ScoreSeq = seq;
+			Score->Apply(event);
+			ScoreDiverged = false;
+			ShowScore();
+		} else if(seq != ScoreSeq){
+			if(seq != (uint8_t)(ScoreSeq + 1)){ ScoreDiverged = true;}
+			ScoreSeq = seq;
+			Score->Apply(event);
+			ShowScore();
+		}
+	} else if(size == (1 + sizeof(tsState))){
+		tsState state;
+		ScoreSeq = iDt->Extract();
+		iDt->Extract((uint8_t*) &state, sizeof(tsState));
+		Score->Load(&state);
+		ScoreDiverged = false;
+		ShowScore();
+	}
+
+	ScoreReply(iDt);
+}
+
+//------------------------------------------------------------------------------
+// SCORESUM (broadcast periodically by the controller)
+// | dst | src | len | cmd | seq | checksum (2 bytes) | crc | crc |
+// A node whose last seq or score checksum differs marks itself as diverged;
+// the controller polls SCORESUM (addressed, no payload) and resyncs it.
+// reply (addressed only): | addr | seq | checksum (2 bytes) | diverged |
+//------------------------------------------------------------------------------
+void busScoreSum_OnProcess(NDatagram* iDt){
+
+	if(iDt->Length == 3){
+		uint8_t seq = iDt->Extract();
+		uint16_t sum = iDt->Extract();
+		sum |= (uint16_t)(iDt->Extract() << 8);
+		ScoreDiverged = (seq != ScoreSeq) || (sum != Score->Checksum());
+	}
+
+	ScoreReply(iDt);
+}
+
+//------------------------------------------------------------------------------
+void ScoreReply(NDatagram* iDt){
+	uint16_t sum = Score->Checksum();
+
+	iDt->SwapAddresses();
+	iDt->Flush();
+	iDt->Append(LocalAddress);
+	iDt->Append(ScoreSeq);
+	iDt->Append((uint8_t)(sum & 0xFF));
+	iDt->Append((uint8_t)(sum >> 8));
+	iDt->Append((uint8_t) ScoreDiverged);
+	iDt->UpdateCrc();
+}
+
+//------------------------------------------------------------------------------
+void ShowScore(){
+	Score->Render(ScoreParams);
+	ShowScoreParams();
+	StandbyTimer->Start(STANDBY_IDLE_TIME);
+}
+
+//------------------------------------------------------------------------------
+// PROFILE (servo PPM profile and motion ramps, per node)
+// | dst | src | len | cmd | [ profile [ ramp ] ] | crc | crc |
+// profile: | tick | frame | shown | hidden | clear | travel | (2 bytes each, LSB
+//          first; microseconds, travel in milliseconds), see fdProfile
+// ramp:    | clear | H | V | arrow | (1 byte each, PPM frames, 0..RAMP_FRAMES_MAX)
+//          optional: without it the current ramps are kept
+// Without a profile the current settings are returned; with a profile they are
+// applied (digit idle only) and saved to the settings page.
+// reply: | addr | result | profile | ramp |
+//   result: 0 = ok, 1 = rejected, 2 = not saved
+//------------------------------------------------------------------------------
+void busProfile_OnProcess(NDatagram* iDt){
+	uint8_t result = 0;
+	uint8_t size = iDt->Length;
+
+	if((size == sizeof(fdProfile)) || (size == sizeof(fdProfile) + RAMP_PHASES)){
+		NodeConfig config = Config;
+		uint16_t* field = (uint16_t*) &config.profile;
+		for(uint8_t c=0; c<(sizeof(fdProfile) / 2); c++){
+			field[c] = iDt->Extract();
+			field[c] |= (uint16_t)(iDt->Extract() << 8);
+		}
+		for(int r=0; r<RAMP_PHASES; r++){
+			config.ramp[r] = (size > sizeof(fdProfile)) ? iDt->Extract() : Digit->Ramp[r];
+			if(config.ramp[r] > RAMP_FRAMES_MAX){ result = 1;}
+		}
+
+		if((result == 0) && Digit->SetProfile(config.profile)){
+			for(int r=0; r<RAMP_PHASES; r++){ Digit->Ramp[r] = config.ramp[r];}
+			Config = config;
+			if(!ConfigSave(&Config)){ result = 2;}
+		} else { result = 1;}
+	}
+
+	fdProfile current = Digit->Profile();
+	uint16_t* field = (uint16_t*) &current;
+	iDt->SwapAddresses();
+	iDt->Flush();
+	iDt->Append(LocalAddress);
+	iDt->Append(result);
+	for(uint8_t c=0; c<(sizeof(fdProfile) / 2); c++){
+		iDt->Append((uint8_t)(field[c] & 0xFF));
+		iDt->Append((uint8_t)(field[c] >> 8));
+	}
+	for(int r=0; r<RAMP_PHASES; r++){ iDt->Append(Digit->Ramp[r]);}
+	iDt->UpdateCrc();
+}
+
+//------------------------------------------------------------------------------
+// Settings page (see EDROS_F103_C6_FLASH.ld): | magic | config | crc32 |
+// It is the last page of the C6's 32K flash; a node whose page holds no valid
+// record (never saved) runs on the defaults.
+extern "C" uint32_t _config_start;
+#define CONFIG_START		((uint32_t) &_config_start)
+
+struct ConfigRecord{
+	uint32_t magic;
+	NodeConfig config;
+	uint32_t crc;
+};
+
+//------------------------------------------------------------------------------
+bool ConfigLoad(NodeConfig* config){
+	const ConfigRecord* record = (const ConfigRecord*) CONFIG_START;
+
+	if(record->magic != CONFIG_MAGIC){ return(false);}
+	if(FirmwareUpdate::Crc32((const uint8_t*) &record->config, sizeof(NodeConfig)) != record->crc){
+		return(false);
+	}
+	*config = record->config;
+	return(true);
+}
+
+//------------------------------------------------------------------------------
+// Erase and program stall the CPU for ~20ms: only called from PROFILE and
+// SIGNATURE, with the digit idle.
+bool ConfigSave(const NodeConfig* config){
+	ConfigRecord record;
+	bool result;
+
+	record.magic = CONFIG_MAGIC;
+	record.config = *config;
+	record.crc = FirmwareUpdate::Crc32((const uint8_t*) config, sizeof(NodeConfig));
+
+	FirmwareUpdate::Unlock();
+	result = FirmwareUpdate::ErasePage(CONFIG_START);
+	if(result){
+		result = FirmwareUpdate::Program(CONFIG_START, (const uint8_t*) &record, sizeof(ConfigRecord));
+	}
+	FirmwareUpdate::Lock();
+	return(result);
+}
+
+//------------------------------------------------------------------------------
+// MEMORY (stack and heap high-water marks)
+// | dst | src | len | cmd | crc | crc |
+// reply: | addr | stack size | stack peak | main | interrupt | heap used |
+//          heap peak | heap blocks | heap extent | fragmentation |
+// 2 bytes each, LSB first; bytes, fragmentation in per mille (see MemoryStats.h)
+// main, interrupt and the heap items are 0 unless built with DIAGNOSTICS_ENABLED
+// ("Diagnostics" configuration)
+//------------------------------------------------------------------------------
+void busMemory_OnProcess(NDatagram* iDt){
+	uint32_t result[MEM_ITEMS];
+
+	MemRead(result);
+
+	iDt->SwapAddresses();
+	iDt->Flush();
+	iDt->Append(LocalAddress);
+	for(int c=0; c<MEM_ITEMS; c++){
+		iDt->Append((uint8_t)(result[c] & 0xFF));
+		iDt->Append((uint8_t)(result[c] >> 8));
+	}
+	iDt->UpdateCrc();
+}
+
 //------------------------------------------------------------------------------
 void AddressResolution(){
 	LocalAddress = 0;
@@ -0,0 +1,63 @@
+//==============================================================================
+#include "Benchmark.h"
+
+BenchProbe BenchProbes[BENCH_PROBES];
+uint32_t BenchWindow = 0;
+
+//------------------------------------------------------------------------------
+void BenchReset(){
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	for(int p=0; p<BENCH_PROBES; p++){
+		BenchProbes[p].min = 0xFFFFFFFF;
+		BenchProbes[p].max = 0;
+		BenchProbes[p].sum = 0;
+		BenchProbes[p].count = 0;
+		BenchProbes[p].window = 0;
+		// a window open across the reset counts from now on
+		BenchProbes[p].opened = DWT->CYCCNT;
+		BenchProbes[p].windowed = BenchProbes[p].open;
+	}
+	BenchWindow = DWT->CYCCNT;
+}
+
+//------------------------------------------------------------------------------
+void BenchOpen(uint8_t p){
+	BenchProbe* probe = &BenchProbes[p];
+
+	if(probe->open){ return;}
+	probe->opened = DWT->CYCCNT;
+	probe->open = true;
+	probe->windowed = true;
+}
+
+//------------------------------------------------------------------------------
+void BenchClose(uint8_t p){
+	BenchProbe* probe = &BenchProbes[p];
+
+	if(!probe->open){ return;}
+	probe->window += DWT->CYCCNT - probe->opened;
+	probe->open = false;
+}
+
+//------------------------------------------------------------------------------
+// The window is limited by the 32 bit cycle counter (about 59s at 72MHz); for
+// a windowed probe, that is the open time added up.
+void BenchRead(uint8_t p, uint32_t* result){
+	uint32_t elapsed = DWT->CYCCNT - BenchWindow;
+	BenchProbe* probe = &BenchProbes[p];
+
+	if(probe->windowed){
+		elapsed = probe->window;
+		if(probe->open){ elapsed += DWT->CYCCNT - probe->opened;}
+	}
+
+	result[0] = (probe->count > 0) ? probe->min : 0;
+	result[1] = (probe->count > 0) ? (probe->sum / probe->count) : 0;
+	result[2] = probe->max;
+	result[3] = probe->count;
+	result[4] = (elapsed > 1000) ? (probe->sum / (elapsed / 1000)) : 0;
+}
+
+//==============================================================================
@@ -0,0 +1,63 @@
+//==============================================================================
+#include "BlockMap.h"
+
+//------------------------------------------------------------------------------
+BlockMap::BlockMap(){
+	Reset(0);
+}
+
+//------------------------------------------------------------------------------
+bool BlockMap::Reset(uint16_t new_blocks){
+	for(int c=0; c<BLOCKMAP_SIZE; c++){ received[c] = 0;}
+	if(new_blocks > BLOCKMAP_BLOCKS_MAX){
+		blocks = 0; missing = 0;
+		return(false);
+	}
+	blocks = new_blocks;
+	missing = new_blocks;
+	return(true);
+}
+
+//------------------------------------------------------------------------------
+bool BlockMap::Set(uint16_t index){
+	uint8_t mask = (uint8_t)(0x01 << (index & 0x07));
+
+	if(index >= blocks){ return(false);}
+	if(!(received[index >> 3] & mask)){
+		received[index >> 3] |= mask;
+		missing--;
+	}
+	return(true);
+}
+
+//------------------------------------------------------------------------------
+bool BlockMap::Has(uint16_t index){
+	if(index >= blocks){ return(false);}
+	return((received[index >> 3] & (0x01 << (index & 0x07))) != 0);
+}
+
+//------------------------------------------------------------------------------
+void BlockMap::Missing(uint8_t* buffer, uint8_t offset, uint8_t size){
+	for(int c=0; c<size; c++){
+		uint16_t n = offset + c;
+		uint8_t map = 0x00;
+		if(n < BLOCKMAP_SIZE){
+			map = (uint8_t) ~received[n];
+			// blocks beyond the transfer are not missing
+			for(int b=0; b<8; b++){
+				if(((n << 3) + b) >= blocks){ map &= (uint8_t) ~(0x01 << b);}
+			}
+		}
+		buffer[c] = map;
+	}
+}
+
+//------------------------------------------------------------------------------
+uint16_t BlockMap::FirstMissing(){
+	for(uint16_t index = 0; index < blocks; index++){
+		if(!(received[index >> 3] & (0x01 << (index & 0x07)))){ return(index);}
+	}
+	return(blocks);
+}
+
+//==============================================================================
@@ -0,0 +1,144 @@
+//==============================================================================
+#include "BusUart.h"
+
+#ifndef BUS_NSERIAL
+
+static BusUart* bus_uart = NULL;
+
+//------------------------------------------------------------------------------
+BusUart::BusUart(uint32_t baud){
+	OnPacket = NULL;
+	OnEnterTransmission = NULL;
+	OnLeaveTransmission = NULL;
+
+	Baud = baud;
+	IrqPriority = 0;
+	Dropped = 0;
+	head = 0;
+	tail = 0;
+	start = 0;
+	sending = false;
+	bus_uart = this;
+}
+
+//------------------------------------------------------------------------------
+void BusUart::Open(){
+	uint32_t pclk2 = SystemCoreClock;
+	uint32_t ppre2 = (RCC->CFGR & RCC_CFGR_PPRE2) >> RCC_CFGR_PPRE2_Pos;
+
+	RCC->APB2ENR |= RCC_APB2ENR_IOPAEN | RCC_APB2ENR_AFIOEN | RCC_APB2ENR_USART1EN;
+	RCC->AHBENR |= RCC_AHBENR_DMA1EN;
+
+	// PA9: alternate function push-pull, 50MHz; PA10: input with pull-up (the
+	// receiver output floats while RE is high)
+	GPIOA->CRH = (GPIOA->CRH & ~(0xFFUL << 4)) | (0x0BUL << 4) | (0x08UL << 8);
+	GPIOA->BSRR = (0x01UL << 10);
+
+	USART1->CR1 = 0;
+	if(ppre2 & 0x04){ pclk2 >>= (ppre2 & 0x03) + 1;}
+	USART1->BRR = (pclk2 + Baud / 2) / Baud;
+	USART1->CR3 = USART_CR3_DMAR | USART_CR3_DMAT;
+
+	// receive: circular, never stopped; the write position is BUS_RX_RING - CNDTR
+	DMA1_Channel5->CCR = 0;
+	DMA1_Channel5->CPAR = (uint32_t) &USART1->DR;
+	DMA1_Channel5->CMAR = (uint32_t) ring;
+	DMA1_Channel5->CNDTR = BUS_RX_RING;
+	DMA1_Channel5->CCR = DMA_CCR_MINC | DMA_CCR_CIRC | DMA_CCR_PL_1 | DMA_CCR_EN;
+
+	// transmit: one frame per Write()
+	DMA1_Channel4->CCR = 0;
+	DMA1_Channel4->CPAR = (uint32_t) &USART1->DR;
+	DMA1_Channel4->CMAR = (uint32_t) tx;
+
+	NVIC_SetPriority(USART1_IRQn, IrqPriority);
+	NVIC_SetPriority(DMA1_Channel4_IRQn, IrqPriority);
+	NVIC_EnableIRQ(USART1_IRQn);
+	NVIC_EnableIRQ(DMA1_Channel4_IRQn);
+
+	USART1->CR1 = USART_CR1_UE | USART_CR1_TE | USART_CR1_RE | USART_CR1_IDLEIE;
+}
+
+//------------------------------------------------------------------------------
+bool BusUart::Write(uint8_t* data, uint8_t size){
+	if(sending || (size == 0) || (size > BUS_FRAME_MAX)){ return(false);}
+	for(uint8_t c=0; c<size; c++){ tx[c] = data[c];}
+
+	sending = true;
+	if(OnEnterTransmission != NULL){ OnEnterTransmission();}
+
+	DMA1_Channel4->CNDTR = size;
+	USART1->SR = ~USART_SR_TC;
+	DMA1_Channel4->CCR = DMA_CCR_MINC | DMA_CCR_DIR | DMA_CCR_TCIE | DMA_CCR_PL_0 | DMA_CCR_EN;
+	return(true);
+}
+
+//------------------------------------------------------------------------------
+// The last byte is still in the shift register: wait for the USART TC.
+void BusUart::DmaTxIrq(){
+	if(DMA1->ISR & DMA_ISR_TCIF4){
+		DMA1->IFCR = DMA_IFCR_CGIF4;
+		DMA1_Channel4->CCR = 0;
+		USART1->CR1 |= USART_CR1_TCIE;
+	}
+}
+
+//------------------------------------------------------------------------------
+void BusUart::UsartIrq(){
+	uint32_t sr = USART1->SR;
+
+	if(sr & USART_SR_IDLE){
+		// SR then DR clears IDLE (and ORE, NE, FE); the DMA has the data already
+		(void) USART1->DR;
+		uint8_t next = (uint8_t)((head + 1) % BUS_FRAMES_QUEUED);
+		if(next != tail){
+			ends[head] = (uint16_t)(BUS_RX_RING - DMA1_Channel5->CNDTR) & (BUS_RX_RING - 1);
+			head = next;
+		} else {
+			Dropped++;
+		}
+	}
+
+	if((sr & USART_SR_TC) && (USART1->CR1 & USART_CR1_TCIE)){
+		USART1->CR1 &= ~USART_CR1_TCIE;
+		if(OnLeaveTransmission != NULL){ OnLeaveTransmission();}
+		sending = false;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Frames are copied out of the ring here, in the main loop; the ring holds
+// BUS_RX_RING bytes of traffic, so this must run before that much more
+// arrives (~270ms at 9600 baud, ~33ms at 8x).
+void BusUart::Notify(NMESSAGE* msg){
+
+	if(msg->message == NM_TIMETICK){
+		while(tail != head){
+			uint16_t end = ends[tail];
+			uint16_t size = (uint16_t)(end - start) & (BUS_RX_RING - 1);
+
+			if(size > BUS_FRAME_MAX){
+				Dropped++;
+			} else if(size > 0){
+				for(uint16_t c=0; c<size; c++){ frame[c] = ring[(start + c) & (BUS_RX_RING - 1)];}
+				if(OnPacket != NULL){ OnPacket(frame, (uint8_t) size);}
+			}
+			start = end;
+			tail = (uint8_t)((tail + 1) % BUS_FRAMES_QUEUED);
+		}
+	}
+	msg->message = NM_NULL;
+}
+
+//------------------------------------------------------------------------------
+extern "C" void USART1_IRQHandler(){
+	if(bus_uart != NULL){ bus_uart->UsartIrq();}
+}
+
+//------------------------------------------------------------------------------
+extern "C" void DMA1_Channel4_IRQHandler(){
+	if(bus_uart != NULL){ bus_uart->DmaTxIrq();}
+}
+
+#endif
+//==============================================================================
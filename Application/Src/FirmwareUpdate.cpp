@@ -0,0 +1,243 @@
+//==============================================================================
+#include "FirmwareUpdate.h"
+
+//------------------------------------------------------------------------------
+FirmwareUpdate::FirmwareUpdate(){
+	state = fuIdle;
+	image_size = 0;
+	image_crc = 0;
+}
+
+//------------------------------------------------------------------------------
+bool FirmwareUpdate::Begin(uint32_t size, uint32_t crc){
+
+	// the staging slot sits in the upper half of a 64K die (64K builds only)
+	if((SLOT_B_SIZE == 0) || !Present(SLOT_B_START, SLOT_B_SIZE)){
+		state = fuUnsupported;
+		return(false);
+	}
+
+	if((size == 0)||(size > SLOT_A_SIZE)||(size > SLOT_B_SIZE)||
+	   (size > (UPDATE_BLOCKS_MAX * UPDATE_BLOCK_SIZE))){
+		state = fuFailed;
+		return(false);
+	}
+
+	image_size = size;
+	image_crc = crc;
+	received.Reset((uint16_t)((size + UPDATE_BLOCK_SIZE - 1) / UPDATE_BLOCK_SIZE));
+
+	// erase every page the image will use, up front, so that block writes
+	// (which arrive at bus speed) only program; the tag page is always erased
+	// (an old tag must not survive into a new update)
+	Unlock();
+	for(uint32_t addr = 0; addr < size; addr += UPDATE_PAGE_SIZE){
+		if(!ErasePage(SLOT_B_START + addr)){
+			Lock();
+			state = fuFailed;
+			return(false);
+		}
+	}
+	if((UPDATE_TAG - SLOT_B_START) >= ((size + UPDATE_PAGE_SIZE - 1) & ~(UPDATE_PAGE_SIZE - 1))){
+		if(!ErasePage(UPDATE_TAG & ~(UPDATE_PAGE_SIZE - 1))){
+			Lock();
+			state = fuFailed;
+			return(false);
+		}
+	}
+	Lock();
+
+	state = fuReceiving;
+	return(true);
+}
+
+//------------------------------------------------------------------------------
+bool FirmwareUpdate::Block(uint16_t index, const uint8_t* data, uint8_t size){
+
+	if(state != fuReceiving){ return(false);}
+	if(index >= received.Blocks()){ return(false);}
+	if(received.Has(index)){ return(true);}
+
+	// only the last block may be short
+	uint32_t offset = (uint32_t) index * UPDATE_BLOCK_SIZE;
+	uint32_t expected = image_size - offset;
+	if(expected > UPDATE_BLOCK_SIZE){ expected = UPDATE_BLOCK_SIZE;}
+	if(size != expected){ return(false);}
+
+	Unlock();
+	bool result = Program(SLOT_B_START + offset, data, size);
+	Lock();
+
+	// read back: a block only counts as received once it is in flash
+	const uint8_t* stored = (const uint8_t*)(SLOT_B_START + offset);
+	for(int c=0; (c<size) && result; c++){
+		if(stored[c] != data[c]){ result = false;}
+	}
+
+	if(result){ received.Set(index);}
+	return(result);
+}
+
+//------------------------------------------------------------------------------
+bool FirmwareUpdate::Verify(){
+	if((state != fuReceiving)&&(state != fuVerified)){ return(false);}
+	if(received.Pending() > 0){ return(false);}
+
+	if(Crc32((const uint8_t*) SLOT_B_START, image_size) == image_crc){
+		state = fuVerified;
+		return(true);
+	}
+	state = fuFailed;
+	return(false);
+}
+
+//------------------------------------------------------------------------------
+uint8_t FirmwareUpdate::OnBegin(const uint8_t* request, uint8_t length, bool busy, uint8_t* reply){
+	if(busy){
+		reply[0] = fuBusy;
+		return(1);
+	}
+	if(length == 8){
+		uint32_t size = request[0] | (request[1] << 8) | (request[2] << 16) | ((uint32_t) request[3] << 24);
+		uint32_t crc = request[4] | (request[5] << 8) | (request[6] << 16) | ((uint32_t) request[7] << 24);
+		Begin(size, crc);
+	}
+	reply[0] = (uint8_t) state;
+	return(1);
+}
+
+//------------------------------------------------------------------------------
+uint8_t FirmwareUpdate::OnBlock(const uint8_t* request, uint8_t length, bool busy, uint8_t* reply){
+
+	reply[0] = (uint8_t) state;
+	if((length > 2) && (length <= (UPDATE_BLOCK_SIZE + 2))){
+		// programming stalls the CPU, and with it the PPM tick of a moving digit
+		if(busy){ reply[0] = fuBusy;}
+		else {
+			Block(request[0] | (request[1] << 8), request + 2, length - 2);
+			reply[0] = (uint8_t) state;
+		}
+	}
+
+	uint16_t pending = received.Pending();
+	reply[1] = (uint8_t)(pending & 0xFF);
+	reply[2] = (uint8_t)(pending >> 8);
+	return(3);
+}
+
+//------------------------------------------------------------------------------
+uint8_t FirmwareUpdate::OnStatus(const uint8_t* request, uint8_t length, uint8_t* reply){
+	uint8_t offset = 0;
+
+	if(length > 0){ offset = request[0];}
+	uint16_t pending = received.Pending();
+	uint16_t first = received.FirstMissing();
+	reply[0] = (uint8_t) state;
+	reply[1] = (uint8_t)(pending & 0xFF);
+	reply[2] = (uint8_t)(pending >> 8);
+	reply[3] = (uint8_t)(first & 0xFF);
+	reply[4] = (uint8_t)(first >> 8);
+	reply[5] = offset;
+	received.Missing(reply + 6, offset, UPDATE_STATUS_WINDOW);
+	return(6 + UPDATE_STATUS_WINDOW);
+}
+
+//------------------------------------------------------------------------------
+uint8_t FirmwareUpdate::OnApply(uint8_t* reply){
+	Verify();
+	reply[0] = (uint8_t) state;
+	return(1);
+}
+
+//------------------------------------------------------------------------------
+void FirmwareUpdate::Unlock(){
+	if(FLASH->CR & FLASH_CR_LOCK){
+		FLASH->KEYR = FLASH_KEY1;
+		FLASH->KEYR = FLASH_KEY2;
+	}
+}
+
+//------------------------------------------------------------------------------
+void FirmwareUpdate::Lock(){
+	FLASH->CR |= FLASH_CR_LOCK;
+}
+
+//------------------------------------------------------------------------------
+bool FirmwareUpdate::Present(uint32_t address, uint32_t size){
+	return((uint32_t)(DEVICE_FLASH_KB * 1024) >= (address - FLASH_BASE + size));
+}
+
+//------------------------------------------------------------------------------
+bool FirmwareUpdate::ErasePage(uint32_t address){
+	while(FLASH->SR & FLASH_SR_BSY){}
+	FLASH->SR = FLASH_SR_EOP | FLASH_SR_PGERR | FLASH_SR_WRPRTERR;
+	FLASH->CR |= FLASH_CR_PER;
+	FLASH->AR = address;
+	FLASH->CR |= FLASH_CR_STRT;
+	while(FLASH->SR & FLASH_SR_BSY){}
+	FLASH->CR &= ~FLASH_CR_PER;
+	return((FLASH->SR & (FLASH_SR_PGERR | FLASH_SR_WRPRTERR)) == 0);
+}
+
+//------------------------------------------------------------------------------
+// programs half-words; an odd trailing byte is padded with 0xFF
+bool FirmwareUpdate::Program(uint32_t address, const uint8_t* data, uint16_t size){
+	bool result = true;
+	while(FLASH->SR & FLASH_SR_BSY){}
+	FLASH->SR = FLASH_SR_EOP | FLASH_SR_PGERR | FLASH_SR_WRPRTERR;
+	FLASH->CR |= FLASH_CR_PG;
+	for(uint16_t c=0; c<size; c+=2){
+		uint16_t half = data[c];
+		if((c + 1) < size){ half |= (uint16_t)(data[c+1] << 8);}
+		else { half |= 0xFF00;}
+		*(volatile uint16_t*)(address + c) = half;
+		while(FLASH->SR & FLASH_SR_BSY){}
+		if(FLASH->SR & (FLASH_SR_PGERR | FLASH_SR_WRPRTERR)){ result = false; break;}
+	}
+	FLASH->CR &= ~FLASH_CR_PG;
+	return(result);
+}
+
+//------------------------------------------------------------------------------
+// CRC-32 (IEEE 802.3, reflected, init and final xor 0xFFFFFFFF). Bitwise, so
+// it costs no flash for a table; ~20ms for a 32K image at 72MHz.
+uint32_t FirmwareUpdate::Crc32(const uint8_t* data, uint32_t size){
+	uint32_t crc = 0xFFFFFFFF;
+	while(size--){
+		crc ^= *data++;
+		for(int b=0; b<8; b++){
+			if(crc & 1){ crc = (crc >> 1) ^ 0xEDB88320;}
+			else { crc >>= 1;}
+		}
+	}
+	return(~crc);
+}
+
+//------------------------------------------------------------------------------
+// The copy itself is left to the boot stage (UpdateBoot.cpp), which runs from
+// the boot page that updates never rewrite: a copy cut by a power loss is
+// simply done again at the next reset.
+void FirmwareUpdate::Apply(){
+	fuTag tag;
+
+	if(state != fuVerified){ return;}
+	tag.magic = UPDATE_TAG_MAGIC;
+	tag.size = image_size;
+	tag.crc = image_crc;
+	tag.done = 0xFFFFFFFF;
+
+	// size and crc first, the magic last: a tag cut by a power loss is ignored
+	Unlock();
+	bool result = Program(UPDATE_TAG + 4, (const uint8_t*) &tag.size, 8);
+	if(result){ result = Program(UPDATE_TAG, (const uint8_t*) &tag.magic, 4);}
+	Lock();
+	if(!result){
+		state = fuFailed;
+		return;
+	}
+
+	__disable_irq();
+	NVIC_SystemReset();
+}
+
+//==============================================================================
@@ -0,0 +1,222 @@
+//==============================================================================
+#include "FlipDisplayBank.h"
+
+
+//------------------------------------------------------------------------------
+FlipDisplayBank::FlipDisplayBank(TIM_TypeDef* TIMn, uint8_t Digits):NHardwareTimer(TIMn){
+
+    OnValueUpdate = NULL;
+    OnMoveStart = NULL;
+
+    //---------------------------
+    Enabled = true;
+    if(Digits > BANK_DIGITS_MAX){ Digits = BANK_DIGITS_MAX;}
+    if(Digits == 0){ Digits = 1;}
+    digits = Digits;
+    channel = new FlipSequencer[digits];
+    ppm_period = channel[0].Frame();
+    frame = ppm_period;
+    load = 0;
+    running = false;
+    Budget = BANK_LOAD_DIGIT;
+
+    for(int d=0; d<BANK_DIGITS_MAX; d++){
+    	share[d] = 0;
+    	value[d] = 0;
+    	glyph[d] = ' ';
+    }
+}
+
+//------------------------------------------------------------------------------
+FlipSequencer* FlipDisplayBank::Channel(uint8_t d){
+	if(d >= digits){ return(NULL);}
+	return(&channel[d]);
+}
+
+//------------------------------------------------------------------------------
+uint8_t FlipDisplayBank::GetValue(uint8_t d){
+	if(d >= digits){ return(0);}
+    return(value[d]);
+}
+
+//------------------------------------------------------------------------------
+void FlipDisplayBank::SetValue(uint8_t d, uint8_t new_value){
+	if((Enabled == false)||(d >= digits)){ return;}
+	value[d] = new_value;
+	if(new_value > 0x0F){ new_value = 0x10;}
+	Show(d, conversion_table[new_value]);
+}
+
+//------------------------------------------------------------------------------
+char FlipDisplayBank::GetGlyph(uint8_t d){
+	if(d >= digits){ return(' ');}
+	return(glyph[d]);
+}
+
+//------------------------------------------------------------------------------
+void FlipDisplayBank::SetGlyph(uint8_t d, char new_glyph){
+	if((Enabled == false)||(d >= digits)){ return;}
+	glyph[d] = new_glyph;
+	if((new_glyph < 0x20)||(new_glyph > 0x7F)){ new_glyph = ' ';}
+	Show(d, glyph_table[new_glyph - 0x20]);
+}
+
+//------------------------------------------------------------------------------
+uint8_t FlipDisplayBank::GetPattern(uint8_t d){
+	if(d >= digits){ return(0);}
+	return(channel[d].Pattern());
+}
+
+//------------------------------------------------------------------------------
+void FlipDisplayBank::SetPattern(uint8_t d, uint8_t new_pattern){
+	if((Enabled == false)||(d >= digits)){ return;}
+	Show(d, new_pattern & SERVOS_DIGIT);
+}
+
+//------------------------------------------------------------------------------
+void FlipDisplayBank::Show(uint8_t d, uint8_t new_pattern){
+	switch(channel[d].Show(new_pattern)){
+		case fsStarted: StartTimebase(); break;
+		case fsShown: ValueUpdated(d); break;
+		default: break;
+	}
+}
+
+//------------------------------------------------------------------------------
+bool FlipDisplayBank::GetArrow(uint8_t d){
+	if(d >= digits){ return(false);}
+	return(channel[d].Arrow());
+}
+
+//------------------------------------------------------------------------------
+void FlipDisplayBank::SetArrow(uint8_t d, bool status){
+	if((Enabled == false)||(d >= digits)){ return;}
+	if(channel[d].SetArrow(status)){ StartTimebase();}
+}
+
+//------------------------------------------------------------------------------
+void FlipDisplayBank::DebugServo(uint8_t d, uint8_t* params){
+	if((Enabled == false)||(d >= digits)){ return;}
+	if(channel[d].DebugServo(params)){ StartTimebase();}
+}
+
+//------------------------------------------------------------------------------
+bool FlipDisplayBank::Busy(){
+	for(int d=0; d<digits; d++){
+		if(channel[d].Busy()){ return(true);}
+	}
+	return(false);
+}
+
+//------------------------------------------------------------------------------
+// All digits share the timebase, so they take the profile together (the
+// first one validates it; the others are idle and take it the same way)
+bool FlipDisplayBank::SetProfile(const fdProfile& new_profile){
+	if(Busy()){ return(false);}
+	for(int d=0; d<digits; d++){
+		if(!channel[d].SetProfile(new_profile)){ return(false);}
+	}
+	ppm_period = channel[0].Frame();
+	frame = ppm_period;
+	return(true);
+}
+
+//------------------------------------------------------------------------------
+void FlipDisplayBank::StartTimebase(){
+	if(!running){
+		running = true;
+		frame = ppm_period;
+		Start(channel[0].Profile().tick);
+	}
+}
+
+//------------------------------------------------------------------------------
+void FlipDisplayBank::StopTimebase(){
+	if(running && !Busy()){
+		Stop();
+		running = false;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Claims "amount" servos from the shared budget. A digit that already holds
+// a share (arrow move right after a digit move) keeps it.
+bool FlipDisplayBank::Admit(uint8_t d, uint8_t amount){
+	if(share[d] >= amount){ return(true);}
+	if((load - share[d] + amount) > Budget){
+		// an idle bank must always be able to move one digit at a time
+		if(load != share[d]){ return(false);}
+	}
+	load = load - share[d] + amount;
+	share[d] = amount;
+
+	// align this digit's frame start with its slot in the shared frame
+	uint16_t offset = (uint16_t)((d * (ppm_period + 1)) / digits);
+	if(frame >= offset){ channel[d].Align(frame - offset);}
+	else { channel[d].Align(frame + (ppm_period + 1) - offset);}
+	return(true);
+}
+
+//------------------------------------------------------------------------------
+void FlipDisplayBank::Release(uint8_t d){
+	load -= share[d];
+	share[d] = 0;
+}
+
+//------------------------------------------------------------------------------
+void FlipDisplayBank::ValueUpdated(uint8_t d){
+	if(OnValueUpdate != NULL){ OnValueUpdate(d);}
+}
+
+//------------------------------------------------------------------------------
+void FlipDisplayBank::MoveStarted(uint8_t d, uint8_t phase, uint8_t segments){
+	if(OnMoveStart != NULL){ OnMoveStart(d, phase, segments);}
+}
+
+//------------------------------------------------------------------------------
+bool FlipDisplayBank::ProcessEvent(){
+	if(Enabled){
+		Advance();
+		for(uint8_t d=0; d<digits; d++){
+			if(share[d] > 0){
+				uint8_t high;
+				uint8_t low = channel[d].Run(high);
+				channel[d].Output(low, high);
+			}
+		}
+	}
+	return(true);
+}
+
+//------------------------------------------------------------------------------
+// Runs each digit's move sequence. A digit leaves "fdServosWaiting" (or enters
+// the arrow move) only when the shared budget has room for it; otherwise it
+// keeps waiting on the next tick.
+void FlipDisplayBank::Notify(NMESSAGE* msg){
+
+    if(Enabled){
+        switch(msg->message){
+            case NM_TIMETICK:
+            	for(uint8_t d=0; d<digits; d++){
+            		FlipSequencer* ch = &channel[d];
+            		if(!ch->Busy()){ continue;}
+
+            		if(ch->Due()){
+            			if((ch->State() == fdServosWaiting) && !Admit(d, BANK_LOAD_DIGIT)){ continue;}
+            			if((ch->State() == fdArrowOn) && !Admit(d, BANK_LOAD_ARROW)){ continue;}
+            		}
+
+            		uint8_t events = ch->Tick();
+            		if(events & SEQ_PHASE){ MoveStarted(d, ch->Phase(), ch->Moving());}
+            		if(events & SEQ_IDLE){ Release(d);}
+            		if(events & SEQ_DONE){ ValueUpdated(d);}
+            	}
+            	StopTimebase();
+                break;
+            default:break;
+        }
+    }
+    msg->message = NM_NULL;
+}
+
+//==============================================================================
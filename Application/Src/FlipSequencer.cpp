@@ -0,0 +1,401 @@
+//==============================================================================
+#include "FlipSequencer.h"
+
+//------------------------------------------------------------------------------
+const fdProfile profile_analog = {
+	PPM_TIMEBASE_100us,					// tick
+	PPM_TIMEBASE_100us * PPM_PERIOD,	// frame: 20ms
+	PPM_SEG_SHOWN * 100,				// shown
+	PPM_SEG_HIDDEN * 100,				// hidden
+	PPM_SEG_CLEAR * 100,				// clear
+	PPM_TRAVEL_DEFAULT					// travel
+};
+
+//------------------------------------------------------------------------------
+FlipSequencer::FlipSequencer(){
+
+    next_state = fdIdle;
+    current_state = fdIdle;
+	previous = 0xFF;
+	pattern = 0x00;
+	target = 0x00;
+	arrow = false;
+	group_to_move = SERVOS_NONE;
+	phase = RAMP_CLEAR;
+	moving = 0x00;
+	phase_length = 0;
+	Delay = 0;
+	Driver_H = NULL;
+	Driver_V = NULL;
+
+    profile.tick = PPM_TIMEBASE_100us;
+    for(int c=0; c<8; c++){
+    	Segment[c] = NULL; segment[c] = PPM_SEG_SHOWN;
+    	pulse[c] = PPM_SEG_SHOWN; origin[c] = PPM_SEG_SHOWN;
+    }
+    SetProfile(profile_analog);
+    for(int r=0; r<RAMP_PHASES; r++){ Ramp[r] = 0;}
+    ramp_step = 0; ramp_length = 0;
+
+    //---------------------------
+    fsm_counter = 0;
+}
+
+//------------------------------------------------------------------------------
+fsShow FlipSequencer::Show(uint8_t new_pattern){
+	pattern = new_pattern;
+	// latched: Tick() moves to it once the move under way is over
+	if(next_state != fdIdle){ return(fsPending);}
+	if(pattern == previous){ return(fsShown);}
+
+	Convert(pattern); target = pattern;
+	next_state = fdServosWaiting; fsm_counter = Delay;
+	return(fsStarted);
+}
+
+//------------------------------------------------------------------------------
+// Sets up the move to a pattern latched by Show() while the digit was busy
+bool FlipSequencer::Latched(){
+	if(pattern == previous){ return(false);}
+	Convert(pattern); target = pattern;
+	return(true);
+}
+
+//------------------------------------------------------------------------------
+bool FlipSequencer::SetArrow(bool status){
+
+	if(status == arrow){ return(false);}
+
+	arrow = status;
+	if(arrow){ segment[Seg_H] = seg_shown;}
+	else { segment[Seg_H] = seg_hidden;}
+
+	if(next_state != fdIdle){ return(false);}
+	next_state = fdArrowOn; fsm_counter = FSM_SERVOS_ON;
+	return(true);
+}
+
+//------------------------------------------------------------------------------
+bool FlipSequencer::DebugServo(uint8_t* params){
+	uint8_t segments = params[PARAM_SEGMENTS];
+	uint16_t duty = ((uint16_t) params[PARAM_DUTY] * 100) / profile.tick;	// 100us units to ticks
+	uint8_t mask = ((uint8_t) 0x01);
+
+	if(duty > 0xFF){ duty = 0xFF;}
+	if(next_state != fdIdle){ return(false);}
+
+	for(int c=0; c<8; c++){
+		//segment is updated
+		if(segments & (mask<<c)){
+			segment[c] = (uint8_t) duty;
+		}
+	}
+
+	group_to_move = segments;
+	target = pattern;
+	next_state = fdServosWaiting; fsm_counter = Delay;
+	return(true);
+}
+
+//------------------------------------------------------------------------------
+bool FlipSequencer::SetProfile(const fdProfile& new_profile){
+	static const uint16_t reference[RAMP_PHASES] = {
+		FSM_SERVOS_CLEARING, FSM_SERVOS_MOVING_H, FSM_SERVOS_MOVING_V, FSM_ARROW_MOVING
+	};
+	uint16_t tick = new_profile.tick;
+
+	if(Busy()){ return(false);}
+	if(tick < PPM_TICK_MIN){ return(false);}
+	// at least two ticks per frame (ppm_period = frame / tick - 1 > 0)
+	if(new_profile.frame / tick < 2){ return(false);}
+	// every pulse at least one tick wide, shorter than one byte of ticks
+	if((new_profile.shown / tick == 0)||(new_profile.hidden / tick == 0)||
+	   (new_profile.clear / tick == 0)){ return(false);}
+	if((new_profile.shown / tick > 0xFF)||(new_profile.hidden / tick > 0xFF)||
+	   (new_profile.clear / tick > 0xFF)){ return(false);}
+	if((new_profile.shown >= new_profile.frame)||(new_profile.hidden >= new_profile.frame)||
+	   (new_profile.clear >= new_profile.frame)){ return(false);}
+	if(new_profile.frame > profile_analog.frame){ return(false);}
+	if((new_profile.travel == 0)||(new_profile.travel > PPM_TRAVEL_DEFAULT)){ return(false);}
+
+	// servos keep their current positions, in the new resolution
+	for(int c=0; c<8; c++){
+		uint32_t width = ((uint32_t) pulse[c] * profile.tick) / tick;
+		if(width > 0xFF){ width = 0xFF;}
+		pulse[c] = (uint8_t) width; segment[c] = pulse[c];
+		origin[c] = pulse[c]; duty[c] = pulse[c];
+	}
+
+	profile = new_profile;
+	ppm_period = (uint16_t)(new_profile.frame / tick) - 1;
+	seg_shown = (uint8_t)(new_profile.shown / tick);
+	seg_hidden = (uint8_t)(new_profile.hidden / tick);
+	seg_clear = (uint8_t)(new_profile.clear / tick);
+
+	// frame length in state machine ticks (1ms), rounded up
+	fsm_frame = (uint8_t)((new_profile.frame + 999) / 1000);
+
+	// move phases scale with the servo travel time, never below 2 frames
+	for(int p=0; p<RAMP_PHASES; p++){
+		uint32_t time = ((uint32_t) reference[p] * new_profile.travel) / PPM_TRAVEL_DEFAULT;
+		if(time < (uint32_t)(2 * fsm_frame)){ time = 2 * fsm_frame;}
+		phase_time[p] = (uint16_t) time;
+	}
+
+	period = ppm_period;
+	return(true);
+}
+
+//------------------------------------------------------------------------------
+uint8_t FlipSequencer::Run(uint8_t& high){
+	uint8_t group = group_to_move;
+	uint8_t mask = 0x01;
+	uint8_t low = 0x00;
+
+	high = 0x00;
+	if(period > 0){
+		period--;
+		for(int c=0; c<8; c++){
+			if(group & (mask << c)){
+				if(duty[c] > 0){ duty[c]--;}
+				else {
+					duty[c] = pulse[c];
+					// reset the "duty signal x" line back to "0"
+					low |= (mask << c);
+				}
+			}
+		}
+	} else {
+		period = ppm_period;
+		if(ramp_step < ramp_length){ ramp_step++;}
+		for(int c=0; c<8; c++){
+			if(group & (mask << c)){
+				// next point of the ramp (or the target itself, without ramp)
+				if(ramp_step < ramp_length){
+					int16_t span = (int16_t) segment[c] - origin[c];
+					pulse[c] = (uint8_t)(origin[c] + (span * ramp_step) / ramp_length);
+				} else {
+					pulse[c] = segment[c];
+				}
+				duty[c] = pulse[c];
+				if((current_state == fdServos_Start_Clear)||(current_state == fdServos_Start_H)||
+						(current_state == fdServos_Start_V)||(current_state == fdArrow_Move)){
+					// set the "duty signal x" high again
+					high |= (mask << c);
+				}
+			}
+		}
+	}
+	return(low);
+}
+
+//------------------------------------------------------------------------------
+void FlipSequencer::Output(uint8_t low, uint8_t high){
+	uint8_t mask = 0x01;
+	for(int c=0; c<8; c++){
+		if(Segment[c] != NULL){
+			if(low & (mask << c)){ Segment[c]->Level = toLow;}
+			if(high & (mask << c)){ Segment[c]->Level = toHigh;}
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Starts a new move phase: servos ramp from where they were last driven
+void FlipSequencer::StartRamp(uint8_t new_phase){
+	moving = 0x00;
+	for(int c=0; c<8; c++){
+		origin[c] = pulse[c];
+		if((group_to_move & (0x01 << c)) && (segment[c] != pulse[c])){ moving |= (0x01 << c);}
+	}
+	ramp_step = 0;
+	ramp_length = Ramp[new_phase];
+	if(ramp_length > RAMP_FRAMES_MAX){ ramp_length = RAMP_FRAMES_MAX;}
+	fsm_counter += (uint32_t) ramp_length * fsm_frame;
+	phase_length = (uint16_t) fsm_counter;
+
+	// only the vertical servos are powered during the V phase
+	if(new_phase == RAMP_V){ moving &= SERVOS_VERTICAL;}
+	phase = new_phase;
+}
+
+//------------------------------------------------------------------------------
+uint8_t FlipSequencer::Tick(){
+	if( fsm_counter>0){ fsm_counter--; return(0);}
+
+	// save current state before changing it
+	current_state = next_state;
+
+	switch(next_state){
+		case fdServosWaiting:
+			fsm_counter = FSM_SERVOS_ON;
+			next_state = fdServosOn;
+			break;
+
+		case fdServosOn:
+    		if(Driver_V != NULL) { Driver_V->Level = toHigh;}
+    		fsm_counter = FSM_SERVOS_ON;
+    		next_state = fdServos_Start_Clear; // next state
+    		break;
+
+		// start moving the
+		case fdServos_Start_Clear:
+			seg_B = segment[Seg_B]; seg_F = segment[Seg_F];
+			segment[Seg_B] = seg_clear;
+			segment[Seg_F] = seg_clear;
+			group_to_move = SERVOS_CLEAR;
+			fsm_counter = phase_time[RAMP_CLEAR];
+			StartRamp(RAMP_CLEAR);
+			next_state = fdServos_Start_H;
+			return(SEQ_PHASE);
+
+		// start moving the horizontal segments
+		case fdServos_Start_H:
+			if(Driver_V != NULL) { Driver_V->Level = toLow;}
+			if(Driver_H != NULL) { Driver_H->Level = toHigh;}
+			segment[Seg_B] = seg_B;
+			segment[Seg_F] = seg_F;
+			group_to_move = SERVOS_HORIZONTAL;
+			fsm_counter = phase_time[RAMP_H];
+			StartRamp(RAMP_H);
+			next_state = fdServos_Stop_H;
+			return(SEQ_PHASE);
+
+		// finish horizontal segments move
+		case fdServos_Stop_H: // fdServosMoving2
+			fsm_counter = FSM_SERVOS_OFF;
+			next_state = fdServos_Start_V;
+			break;
+
+		// start moving the vertical segments
+		case fdServos_Start_V:
+			if(Driver_H != NULL) { Driver_H->Level = toLow;}
+			if(Driver_V != NULL) { Driver_V->Level = toHigh;}
+
+			fsm_counter = phase_time[RAMP_V];
+			//group_to_move = SERVOS_VERTICAL;
+			group_to_move = SERVOS_DIGIT;
+			StartRamp(RAMP_V);
+			next_state = fdServos_Stop_V; // next state
+			return(SEQ_PHASE);
+
+		// finish vertical segments move
+		case fdServos_Stop_V:
+			if(Driver_V != NULL) { Driver_V->Level = toLow;}
+			previous = target;
+			fsm_counter = FSM_SERVOS_OFF;
+			if(Latched()){
+				// servos stay admitted and move again, without the start-up delay
+				next_state = fdServosOn;
+			} else if(Delay == 0){
+				next_state = fdArrowOn; // next state
+			} else {
+				next_state = fdServosOff; // next state
+			}
+			break;
+
+		case fdServosOff:
+			if(Driver_H != NULL){ Driver_H->Level = toLow;}
+			next_state = fdIdle;
+			if(Latched()){ next_state = fdServosWaiting; fsm_counter = Delay;}
+			return(SEQ_IDLE | SEQ_DONE);
+
+		case fdArrowOn:
+    		if(Driver_H != NULL) { Driver_H->Level = toHigh;}
+    		fsm_counter = FSM_SERVOS_ON;
+    		next_state = fdArrow_Move; // next state
+    		break;
+
+		// keep moving
+		case fdArrow_Move:
+			group_to_move = SERVOS_ARROW;
+			fsm_counter = phase_time[RAMP_ARROW];
+			StartRamp(RAMP_ARROW);
+			next_state = fdArrowOff;
+			return(SEQ_PHASE);
+
+		case fdArrowOff:
+			if(Driver_H != NULL){ Driver_H->Level = toLow;}
+			next_state = fdIdle;
+			if(Latched()){ next_state = fdServosWaiting; fsm_counter = Delay;}
+			return(SEQ_IDLE);
+
+		default: break;
+	}
+	return(0);
+}
+
+//------------------------------------------------------------------------------
+// Conversion table (bits):     6   5   4   3   2   1   0      Binary    Hex
+// Segments:             		G   F   E   D   C   B   A
+// Value: 0						-   x   x   x   x   x   x  = 0011 1111 = 0x3F
+// Value: 1						-   -   -   -   x   x   -  = 0000 0110 = 0x06
+// Value: 2						x   -   x   x   -   x   x  = 0101 1011 = 0x5B
+// Value: 3						x   -   -   x   x   x   x  = 0100 1111 = 0x4F
+// Value: 4						x   x   -   -   x   x   -  = 0110 0110 = 0x66
+// Value: 5						x   x   -   x   x   -   x  = 0110 1101 = 0x6D
+// Value: 6						x   x   x   x   x   -   x  = 0111 1101 = 0x7D
+// Value: 7						-   -   -   -   x   x   x  = 0111 1101 = 0x07
+// Value: 8						x   x   x   x   x   x   x  = 0111 1111 = 0x7F
+// Value: 9						x   x   -   x   x   x   x  = 0110 1111 = 0x6F
+// Value: A						x   x   x   -   x   x   x  = 0111 0111 = 0x77
+// Value: b						x   x   x   x   x   -   -  = 0111 1100 = 0x7C
+// Value: C						-   x   x   x   -   -   x  = 0011 1001 = 0x39
+// Value: d						x   -   x   x   x   x   -  = 0101 1110 = 0x5E
+// Value: E						x   x   x   x   -   -   x  = 0111 1001 = 0x79
+// Value: F						x   x   x   -   -   -   x  = 0111 1001 = 0x71
+//------------------------------------------------------------------------------
+const uint8_t conversion_table[17] = {
+  0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07,
+  0x7F, 0x6F, 0x77, 0x7C, 0x39, 0x5E, 0x79, 0x71,
+  0x00
+};
+
+//------------------------------------------------------------------------------
+// Glyph table (ASCII 0x20 to 0x7F), same bit order as the conversion table.
+// Characters without a readable 7-segments shape are blank (0x00). Upper and
+// lower case differ where the display allows it (e.g. 'C' and 'c').
+//------------------------------------------------------------------------------
+const uint8_t glyph_table[96] = {
+  //        !     "     #     $     %     &     '
+  0x00, 0x06, 0x22, 0x00, 0x00, 0x00, 0x00, 0x20,
+  // (     )     *     +     ,     -     .     /
+  0x39, 0x0F, 0x00, 0x00, 0x00, 0x40, 0x00, 0x52,
+  // 0     1     2     3     4     5     6     7
+  0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07,
+  // 8     9     :     ;     <     =     >     ?
+  0x7F, 0x6F, 0x00, 0x00, 0x00, 0x48, 0x00, 0x53,
+  // @     A     B     C     D     E     F     G
+  0x00, 0x77, 0x7C, 0x39, 0x5E, 0x79, 0x71, 0x3D,
+  // H     I     J     K     L     M     N     O
+  0x76, 0x30, 0x1E, 0x75, 0x38, 0x15, 0x37, 0x3F,
+  // P     Q     R     S     T     U     V     W
+  0x73, 0x67, 0x50, 0x6D, 0x78, 0x3E, 0x3E, 0x2A,
+  // X     Y     Z     [     \     ]     ^     _
+  0x76, 0x6E, 0x5B, 0x39, 0x64, 0x0F, 0x23, 0x08,
+  // `     a     b     c     d     e     f     g
+  0x02, 0x5F, 0x7C, 0x58, 0x5E, 0x7B, 0x71, 0x6F,
+  // h     i     j     k     l     m     n     o
+  0x74, 0x10, 0x0C, 0x75, 0x30, 0x14, 0x54, 0x5C,
+  // p     q     r     s     t     u     v     w
+  0x73, 0x67, 0x50, 0x6D, 0x78, 0x1C, 0x1C, 0x14,
+  // x     y     z     {     |     }     ~
+  0x76, 0x6E, 0x5B, 0x39, 0x30, 0x0F, 0x01, 0x00
+};
+
+//------------------------------------------------------------------------------
+void FlipSequencer::Convert(uint8_t converted_value){
+	uint8_t mask=0x01;
+
+	if(arrow){ converted_value |= SERVOS_ARROW;}
+	for(int c=0; c<8; c++){
+
+		if(converted_value & (mask<<c)){
+			segment[c] = seg_shown;
+		} else {
+			segment[c] = seg_hidden;
+		}
+	}
+}
+
+//==============================================================================
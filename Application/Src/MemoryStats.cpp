@@ -0,0 +1,149 @@
+//==============================================================================
+#include <stddef.h>
+#include "MemoryStats.h"
+
+extern "C" uint32_t _estack, _Min_Stack_Size;
+
+#define STACK_TOP			((uint32_t) &_estack)
+#define STACK_SIZE			((uint32_t) &_Min_Stack_Size)
+#define STACK_BOTTOM		(STACK_TOP - STACK_SIZE)
+
+uint32_t MemMainSP = 0xFFFFFFFF;
+uint32_t MemIsrSP = 0xFFFFFFFF;
+
+static uint32_t heap_used = 0;
+static uint32_t heap_peak = 0;
+static uint32_t heap_blocks = 0;
+static uint32_t heap_low = 0xFFFFFFFF;
+static uint32_t heap_high = 0;
+
+//------------------------------------------------------------------------------
+// never paints over a heap block allocated before this call
+void MemPaint(){
+	uint32_t limit = __get_MSP() - MEM_PAINT_MARGIN;
+	uint32_t start = STACK_BOTTOM;
+	if(heap_high > start){ start = (heap_high + 3) & ~((uint32_t) 3);}
+	for(uint32_t* p = (uint32_t*) start; (uint32_t) p < limit; p++){ *p = MEM_PAINT;}
+	MemMainSP = __get_MSP();
+}
+
+//------------------------------------------------------------------------------
+void MemRead(uint32_t* result){
+	uint32_t* p = (uint32_t*) STACK_BOTTOM;
+	uint32_t main_sp = MemMainSP;
+
+	// the first word that lost its paint is the deepest point reached
+	while(((uint32_t) p < STACK_TOP) && (*p == MEM_PAINT)){ p++;}
+
+	result[MEM_STACK_SIZE] = STACK_SIZE;
+	result[MEM_STACK_PEAK] = STACK_TOP - (uint32_t) p;
+#ifdef DIAGNOSTICS_ENABLED
+	result[MEM_STACK_MAIN] = (main_sp < STACK_TOP) ? (STACK_TOP - main_sp) : 0;
+	result[MEM_STACK_ISR] = (result[MEM_STACK_PEAK] > result[MEM_STACK_MAIN]) ?
+			(result[MEM_STACK_PEAK] - result[MEM_STACK_MAIN]) : 0;
+#else
+	// no samples: only the painted peak is known
+	(void) main_sp;
+	result[MEM_STACK_MAIN] = 0;
+	result[MEM_STACK_ISR] = 0;
+#endif
+
+	__disable_irq();
+	result[MEM_HEAP_USED] = heap_used;
+	result[MEM_HEAP_PEAK] = heap_peak;
+	result[MEM_HEAP_BLOCKS] = heap_blocks;
+	result[MEM_HEAP_EXTENT] = (heap_high > heap_low) ? (heap_high - heap_low) : 0;
+	__enable_irq();
+
+	result[MEM_HEAP_FRAG] = (result[MEM_HEAP_EXTENT] > 0) ?
+			((result[MEM_HEAP_EXTENT] - heap_used) * 1000) / result[MEM_HEAP_EXTENT] : 0;
+}
+
+#ifdef DIAGNOSTICS_ENABLED
+//------------------------------------------------------------------------------
+// Heap wrappers (linked with -Wl,--wrap=malloc, free, calloc and realloc; newlib
+// calls _malloc_r directly from calloc and realloc, so each entry point is
+// wrapped): every block carries an 8 byte header with its size, keeping the
+// 8 byte alignment of the underlying allocator.
+#define HEAP_HEADER			8
+
+extern "C" void* __real_malloc(size_t);
+extern "C" void __real_free(void*);
+extern "C" void* __real_realloc(void*, size_t);
+
+//------------------------------------------------------------------------------
+static void HeapAdd(uint8_t* block, uint32_t total){
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	heap_used += total;
+	heap_blocks++;
+	if(heap_used > heap_peak){ heap_peak = heap_used;}
+	if((uint32_t) block < heap_low){ heap_low = (uint32_t) block;}
+	if(((uint32_t) block + total) > heap_high){ heap_high = (uint32_t) block + total;}
+	__set_PRIMASK(primask);
+}
+
+//------------------------------------------------------------------------------
+static void HeapRemove(uint8_t* block){
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	heap_used -= *(uint32_t*) block;
+	heap_blocks--;
+	__set_PRIMASK(primask);
+}
+
+//------------------------------------------------------------------------------
+extern "C" void* __wrap_malloc(size_t size){
+	uint32_t total = (uint32_t) size + HEAP_HEADER;
+	uint8_t* block = (uint8_t*) __real_malloc(total);
+	if(block == NULL){ return(NULL);}
+
+	*(uint32_t*) block = total;
+	HeapAdd(block, total);
+	return(block + HEAP_HEADER);
+}
+
+//------------------------------------------------------------------------------
+extern "C" void __wrap_free(void* ptr){
+	if(ptr == NULL){ return;}
+	uint8_t* block = (uint8_t*) ptr - HEAP_HEADER;
+
+	HeapRemove(block);
+	__real_free(block);
+}
+
+//------------------------------------------------------------------------------
+extern "C" void* __wrap_calloc(size_t count, size_t size){
+	if((size != 0) && (count > (0xFFFFFFFFUL - HEAP_HEADER) / size)){ return(NULL);}
+	uint32_t bytes = (uint32_t)(count * size);
+	uint8_t* ptr = (uint8_t*) __wrap_malloc(bytes);
+	if(ptr == NULL){ return(NULL);}
+
+	for(uint32_t c = 0; c < bytes; c++){ ptr[c] = 0;}
+	return(ptr);
+}
+
+//------------------------------------------------------------------------------
+extern "C" void* __wrap_realloc(void* ptr, size_t size){
+	if(ptr == NULL){ return(__wrap_malloc(size));}
+	if(size == 0){ __wrap_free(ptr); return(NULL);}
+
+	uint32_t total = (uint32_t) size + HEAP_HEADER;
+	uint8_t* block = (uint8_t*) ptr - HEAP_HEADER;
+	uint32_t previous = *(uint32_t*) block;
+
+	// on failure the old block is left untouched (and still counted)
+	uint8_t* moved = (uint8_t*) __real_realloc(block, total);
+	if(moved == NULL){ return(NULL);}
+
+	*(uint32_t*) moved = total;
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	heap_used -= previous; heap_blocks--;
+	__set_PRIMASK(primask);
+	HeapAdd(moved, total);
+	return(moved + HEAP_HEADER);
+}
+#endif
+
+//==============================================================================
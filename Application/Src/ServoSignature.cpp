@@ -0,0 +1,130 @@
+//==============================================================================
+#include "ServoSignature.h"
+
+//------------------------------------------------------------------------------
+ServoSignature::ServoSignature(){
+	phase = 0;
+	segments = 0;
+	moving = 0;
+	for(int p=0; p<SIGNATURE_PHASES; p++){
+		Last[p].peak = 0; Last[p].energy = 0; Last[p].settle = 0;
+	}
+	Forget();
+	ClearFaults();
+}
+
+//------------------------------------------------------------------------------
+void ServoSignature::ClearFaults(){
+	Faults = 0;
+	candidates = 0;
+	for(int c=0; c<8; c++){ suspect[c] = 0;}
+}
+
+//------------------------------------------------------------------------------
+void ServoSignature::Load(const ssFeatures* baseline){
+	for(int p=0; p<SIGNATURE_PHASES; p++){
+		Baseline[p] = baseline[p];
+		Learned[p] = SIGNATURE_LEARN;
+	}
+}
+
+//------------------------------------------------------------------------------
+void ServoSignature::Forget(){
+	for(int p=0; p<SIGNATURE_PHASES; p++){
+		Baseline[p].peak = 0; Baseline[p].energy = 0; Baseline[p].settle = 0;
+		Learned[p] = 0;
+	}
+}
+
+//------------------------------------------------------------------------------
+bool ServoSignature::Complete(){
+	for(int p=0; p<SIGNATURE_PHASES; p++){
+		if(Learned[p] < SIGNATURE_LEARN){ return(false);}
+	}
+	return(true);
+}
+
+//------------------------------------------------------------------------------
+void ServoSignature::Begin(uint8_t new_phase, uint8_t new_segments){
+	phase = (new_phase < SIGNATURE_PHASES) ? new_phase : 0;
+	segments = new_segments;
+	moving = 0;
+	for(int c=0; c<8; c++){
+		if(segments & (0x01 << c)){ moving++;}
+	}
+}
+
+//------------------------------------------------------------------------------
+uint8_t ServoSignature::Process(uint16_t* data, uint16_t size){
+	uint16_t offset, peak = 0;
+	uint32_t energy = 0;
+	uint8_t settle = 0;
+	uint8_t result = 0;
+	bool bad = false;
+
+	if((moving == 0)||(size < 2)){ return(0);}
+
+	// the first sample is taken as the servos start: pre-move (holding) level
+	offset = data[0];
+	for(uint16_t n=1; n<size; n++){
+		uint16_t level = (data[n] > offset) ? (data[n] - offset) : 0;
+		if(level > peak){ peak = level;}
+		energy += level;
+	}
+	for(uint16_t n=1; n<size; n++){
+		if(data[n] > (offset + (peak >> 2))){ settle = (uint8_t) n;}
+	}
+
+	ssFeatures* last = &Last[phase];
+	ssFeatures* base = &Baseline[phase];
+	last->peak = peak / moving;
+	last->energy = (uint16_t)((energy >> 4) / moving);
+	last->settle = settle;
+
+	if(Learned[phase] < SIGNATURE_LEARN){
+		// running average of the first moves
+		uint8_t k = Learned[phase];
+		base->peak = (uint16_t)(((uint32_t) base->peak * k + last->peak) / (k + 1));
+		base->energy = (uint16_t)(((uint32_t) base->energy * k + last->energy) / (k + 1));
+		base->settle = (uint8_t)(((uint16_t) base->settle * k + last->settle) / (k + 1));
+		Learned[phase]++;
+		return(0);
+	}
+
+	// per servo limits for "one servo dead" and "one servo stalled" among
+	// "moving": the share of a single servo shrinks as more of them move
+	uint32_t dead = base->energy - base->energy / (SIGNATURE_DEAD_SHARE * moving);
+	uint32_t jam = base->energy + ((uint32_t) base->energy * (SIGNATURE_JAM_RATIO - 1)) / (2 * moving);
+	uint32_t surge = base->peak + ((uint32_t) base->peak * (SIGNATURE_PEAK_RATIO - 1)) / moving;
+	if(last->energy < dead){ bad = true;}
+	if((last->energy > jam) && (last->settle >= (size - 1))){ bad = true;}
+	if(last->peak > surge){ bad = true;}
+
+	// attribution: the faulty segment is in every bad move and in no good one
+	if(bad){
+		uint8_t common = candidates & segments;
+		candidates = (common != 0) ? common : segments;
+	} else {
+		candidates &= (uint8_t) ~segments;
+	}
+	for(int c=0; c<8; c++){
+		if(!(segments & (0x01 << c))){ continue;}
+		if(!bad){ suspect[c] = 0; continue;}
+		if(suspect[c] < SIGNATURE_RECUR){ suspect[c]++;}
+		if((suspect[c] >= SIGNATURE_RECUR) && (candidates & (0x01 << c))){
+			result |= (uint8_t)(0x01 << c);
+		}
+	}
+
+	if(!bad){
+		// healthy move: let the baseline follow slow drift (1/8 weight)
+		base->peak = base->peak - (base->peak >> 3) + (last->peak >> 3);
+		base->energy = base->energy - (base->energy >> 3) + (last->energy >> 3);
+		base->settle = base->settle - (base->settle >> 3) + (last->settle >> 3);
+	}
+
+	Faults |= result;
+	return(result);
+}
+
+//==============================================================================
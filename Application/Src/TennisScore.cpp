@@ -0,0 +1,172 @@
+//==============================================================================
+#include "TennisScore.h"
+
+//------------------------------------------------------------------------------
+TennisScore::TennisScore(){
+	history_head = 0;
+	history_size = 0;
+	Apply(SCORE_EV_NEW_MATCH);
+}
+
+//------------------------------------------------------------------------------
+bool TennisScore::Apply(uint8_t event){
+	switch(event){
+		case SCORE_EV_POINT_P1:
+		case SCORE_EV_POINT_P2:
+			Push();
+			if(!(state.flags & TS_FINISHED)){ Point(event - SCORE_EV_POINT_P1);}
+			break;
+
+		case SCORE_EV_UNDO:
+			if(history_size == 0){ return(false);}
+			history_head = (history_head + SCORE_HISTORY - 1) % SCORE_HISTORY;
+			history_size--;
+			state = history[history_head];
+			break;
+
+		case SCORE_EV_NEW_SET:
+			Push();
+			if(state.set < (SCORE_SETS - 1)){ NextSet();}
+			break;
+
+		case SCORE_EV_SWITCH_SERVER:
+			Push();
+			state.server ^= 0x01;
+			break;
+
+		case SCORE_EV_NEW_MATCH:
+			state.points[0] = 0; state.points[1] = 0;
+			for(int s=0; s<SCORE_SETS; s++){ state.games[s][0] = 0; state.games[s][1] = 0;}
+			state.set = 0;
+			state.server = 0;
+			state.flags = 0;
+			history_head = 0;
+			history_size = 0;
+			break;
+
+		default: return(false);
+	}
+	return(true);
+}
+
+//------------------------------------------------------------------------------
+void TennisScore::Load(const tsState* new_state){
+	state = *new_state;
+	if(state.set >= SCORE_SETS){ state.set = SCORE_SETS - 1;}
+	state.server &= 0x01;
+	history_head = 0;
+	history_size = 0;
+}
+
+//------------------------------------------------------------------------------
+// saves the state before an event; the oldest entry is dropped when full
+void TennisScore::Push(){
+	history[history_head] = state;
+	history_head = (history_head + 1) % SCORE_HISTORY;
+	if(history_size < SCORE_HISTORY){ history_size++;}
+}
+
+//------------------------------------------------------------------------------
+void TennisScore::Point(uint8_t p){
+	uint8_t* points = state.points;
+	uint8_t o = p ^ 0x01;
+
+	if(points[p] < 0xFF){ points[p]++;}
+
+	if(state.flags & TS_TIEBREAK){
+		// tie-break: serve changes after the first point, then every two
+		if(((points[0] + points[1]) & 0x01) == 1){ state.server ^= 0x01;}
+		if((points[p] >= 7) && (points[p] >= points[o] + 2)){ WinGame(p);}
+	} else {
+		if((points[p] >= 4) && (points[p] >= points[o] + 2)){ WinGame(p);}
+	}
+}
+
+//------------------------------------------------------------------------------
+void TennisScore::WinGame(uint8_t p){
+	uint8_t* games = state.games[state.set];
+	uint8_t o = p ^ 0x01;
+	bool tiebreak = (state.flags & TS_TIEBREAK);
+
+	games[p]++;
+	state.points[0] = 0; state.points[1] = 0;
+	state.flags &= ~TS_TIEBREAK;
+
+	if(tiebreak){
+		// the player who received first in the tie-break serves next
+		state.server = (state.flags & TS_TB_SERVER) ? 0 : 1;
+	} else {
+		state.server ^= 0x01;
+	}
+
+	if(tiebreak || ((games[p] >= 6) && (games[p] >= games[o] + 2))){
+		// set won: count the sets won by this player
+		uint8_t won = 0;
+		for(int s=0; s<=state.set; s++){
+			if(state.games[s][p] > state.games[s][o]){ won++;}
+		}
+		if((won >= (SCORE_SETS / 2) + 1)||(state.set == (SCORE_SETS - 1))){
+			state.flags |= TS_FINISHED;
+		} else {
+			NextSet();
+		}
+	} else if((games[p] == 6) && (games[o] == 6)){
+		state.flags |= TS_TIEBREAK;
+		if(state.server){ state.flags |= TS_TB_SERVER;}
+		else { state.flags &= ~TS_TB_SERVER;}
+	}
+}
+
+//------------------------------------------------------------------------------
+void TennisScore::NextSet(){
+	state.set++;
+	state.points[0] = 0; state.points[1] = 0;
+	state.flags &= ~(TS_TIEBREAK | TS_TB_SERVER);
+}
+
+//------------------------------------------------------------------------------
+void TennisScore::Render(uint8_t* params){
+	static const uint8_t tens[4] = { SCORE_BLANK, 1, 3, 4};
+	static const uint8_t units[4] = { 0, 5, 0, 0};
+
+	for(uint8_t p=0; p<2; p++){
+		uint8_t* out = &params[p * SCORE_PLAYER2];
+		uint8_t points = state.points[p];
+		uint8_t other = state.points[p ^ 0x01];
+
+		if(state.flags & TS_TIEBREAK){
+			if(points > 99){ points = 99;}
+			out[SCORE_TENS] = (points >= 10) ? (points / 10) : SCORE_BLANK;
+			out[SCORE_UNITS] = points % 10;
+		} else if((points >= 3) && (other >= 3)){
+			// deuce: "40" each, advantage: "Ad" for the leader
+			if(points > other){ out[SCORE_TENS] = 0x0A; out[SCORE_UNITS] = 0x0D;}
+			else { out[SCORE_TENS] = 4; out[SCORE_UNITS] = 0;}
+		} else {
+			if(points > 3){ points = 3;}
+			out[SCORE_TENS] = tens[points];
+			out[SCORE_UNITS] = units[points];
+		}
+
+		for(uint8_t s=0; s<SCORE_SETS; s++){
+			out[SCORE_SET1 + s] = (s <= state.set) ? state.games[s][p] : SCORE_BLANK;
+		}
+	}
+
+	params[SCORE_FLAGS] &= ~SCORE_SERVER_MASK;
+	params[SCORE_FLAGS] |= (uint8_t)(0x01 << state.server);
+}
+
+//------------------------------------------------------------------------------
+uint16_t TennisScore::Checksum(){
+	const uint8_t* data = (const uint8_t*) &state;
+	uint16_t sum1 = 0, sum2 = 0;
+
+	for(uint8_t c=0; c<sizeof(tsState); c++){
+		sum1 = (sum1 + data[c]) % 255;
+		sum2 = (sum2 + sum1) % 255;
+	}
+	return((uint16_t)((sum2 << 8) | sum1));
+}
+
+//==============================================================================
@@ -0,0 +1,92 @@
+//==============================================================================
+#include "FirmwareUpdate.h"
+
+//------------------------------------------------------------------------------
+// Boot stage. Lives in the BOOT page (see EDROS_F103_C6_FLASH.ld), which a bus
+// update never rewrites, and runs from reset before the application: when slot
+// B holds a tagged image (fuTag) whose CRC is good and slot A does not hold it
+// yet, the image is copied over slot A, checked and the tag marked done. A
+// copy cut by a power loss is just done again at the next reset.
+// It runs before the C start-up, while slot A may be half written: all it
+// uses is inlined here (no .data, .bss or calls into slot A or the libraries).
+//------------------------------------------------------------------------------
+#define BOOT_INLINE			static inline __attribute__((always_inline))
+
+//------------------------------------------------------------------------------
+BOOT_INLINE uint32_t BootCrc32(uint32_t address, uint32_t size){
+	uint32_t crc = 0xFFFFFFFF;
+	for(uint32_t c=0; c<size; c++){
+		crc ^= *(volatile uint8_t*)(address + c);
+		for(int b=0; b<8; b++){
+			if(crc & 1){ crc = (crc >> 1) ^ 0xEDB88320;}
+			else { crc >>= 1;}
+		}
+	}
+	return(~crc);
+}
+
+//------------------------------------------------------------------------------
+BOOT_INLINE void BootProgram(uint32_t address, uint16_t data){
+	FLASH->CR |= FLASH_CR_PG;
+	*(volatile uint16_t*) address = data;
+	while(FLASH->SR & FLASH_SR_BSY){}
+	FLASH->CR &= ~FLASH_CR_PG;
+}
+
+//------------------------------------------------------------------------------
+BOOT_INLINE void BootCopy(uint32_t size){
+	for(uint32_t page = 0; page < size; page += UPDATE_PAGE_SIZE){
+		while(FLASH->SR & FLASH_SR_BSY){}
+		FLASH->CR |= FLASH_CR_PER;
+		FLASH->AR = SLOT_A_START + page;
+		FLASH->CR |= FLASH_CR_STRT;
+		while(FLASH->SR & FLASH_SR_BSY){}
+		FLASH->CR &= ~FLASH_CR_PER;
+
+		for(uint32_t c = 0; (c < UPDATE_PAGE_SIZE) && ((page + c) < size); c += 2){
+			BootProgram(SLOT_A_START + page + c, *(volatile uint16_t*)(SLOT_B_START + page + c));
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// reset entry (boot vector table in startup_stm32f103c6tx.s)
+extern "C" __attribute__((section(".boot"), used, noreturn))
+void Boot_Handler(){
+	const volatile fuTag* tag = (const volatile fuTag*) UPDATE_TAG;
+
+	// no slot B (32K build): nothing can be staged
+	if((SLOT_B_SIZE > 0) &&
+	   ((uint32_t)(DEVICE_FLASH_KB * 1024) >= (UPDATE_TAG - FLASH_BASE + sizeof(fuTag))) &&
+	   (tag->magic == UPDATE_TAG_MAGIC) && (tag->done == 0xFFFFFFFF) &&
+	   (tag->size > 0) && (tag->size <= SLOT_A_SIZE) && (tag->size <= SLOT_B_SIZE) &&
+	   (BootCrc32(SLOT_B_START, tag->size) == tag->crc)){
+
+		if(FLASH->CR & FLASH_CR_LOCK){
+			FLASH->KEYR = FLASH_KEY1;
+			FLASH->KEYR = FLASH_KEY2;
+		}
+		if(BootCrc32(SLOT_A_START, tag->size) != tag->crc){ BootCopy(tag->size);}
+
+		// only a checked copy is marked done (0x0000 may be written over data);
+		// a bad one is tried again from a clean reset
+		if(BootCrc32(SLOT_A_START, tag->size) != tag->crc){
+			__DSB();
+			SCB->AIRCR = (uint32_t)((0x5FAUL << SCB_AIRCR_VECTKEY_Pos) | SCB_AIRCR_SYSRESETREQ_Msk);
+			__DSB();
+			while(1){}
+		}
+		BootProgram(UPDATE_TAG + 12, 0x0000);
+		BootProgram(UPDATE_TAG + 14, 0x0000);
+		FLASH->CR |= FLASH_CR_LOCK;
+	}
+
+	// start slot A from its own vector table
+	const volatile uint32_t* vector = (const volatile uint32_t*) SLOT_A_START;
+	SCB->VTOR = SLOT_A_START;
+	__set_MSP(vector[0]);
+	((void (*)(void)) vector[1])();
+	while(1){}
+}
+
+//==============================================================================
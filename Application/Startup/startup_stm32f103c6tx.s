@@ -94,6 +94,10 @@ LoopFillZerobss:
 
 /* Call the clock system intitialization function.*/
     bl  SystemInit
+/* Use the vectors of this image (reset went through the boot stage table) */
+  ldr r0, =g_pfnVectors
+  ldr r1, =0xE000ED08
+  str r0, [r1]
 /* Call static constructors */
     bl __libc_init_array
 /* Call the application's entry point.*/
@@ -121,6 +125,15 @@ Infinite_Loop:
 * 0x0000.0000.
 *
 ******************************************************************************/
+/* Boot stage vector table, at 0x0800.0000 (BOOT page, see the linker script
+   and UpdateBoot.cpp): reset runs Boot_Handler, which starts this image */
+  .section .boot_vector,"a",%progbits
+  .type g_pfnBootVectors, %object
+g_pfnBootVectors:
+  .word _estack
+  .word Boot_Handler
+  .size g_pfnBootVectors, .-g_pfnBootVectors
+
   .section .isr_vector,"a",%progbits
   .type g_pfnVectors, %object
   .size g_pfnVectors, .-g_pfnVectors
@@ -0,0 +1,121 @@
+//==============================================================================
+// Host tests for BlockMap (bus firmware update received blocks bitmap).
+//==============================================================================
+#include <stdio.h>
+#include <string.h>
+#include "BlockMap.h"
+
+static int failures = 0;
+
+#define CHECK(x)	do{ if(!(x)){ printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #x); failures++;}}while(0)
+
+//------------------------------------------------------------------------------
+static void TestEmpty(){
+	BlockMap map;
+	uint8_t buffer[4];
+
+	CHECK(map.Blocks() == 0);
+	CHECK(map.Pending() == 0);
+	CHECK(map.FirstMissing() == 0);
+	CHECK(!map.Set(0));
+	CHECK(!map.Has(0));
+	memset(buffer, 0x55, sizeof(buffer));
+	map.Missing(buffer, 0, sizeof(buffer));
+	for(unsigned c=0; c<sizeof(buffer); c++){ CHECK(buffer[c] == 0x00);}
+}
+
+//------------------------------------------------------------------------------
+static void TestReset(){
+	BlockMap map;
+
+	CHECK(map.Reset(10));
+	CHECK(map.Blocks() == 10);
+	CHECK(map.Pending() == 10);
+	CHECK(map.Set(3));
+	CHECK(map.Reset(BLOCKMAP_BLOCKS_MAX));
+	CHECK(map.Pending() == BLOCKMAP_BLOCKS_MAX);
+	CHECK(!map.Has(3));
+	CHECK(!map.Reset(BLOCKMAP_BLOCKS_MAX + 1));
+	CHECK(map.Blocks() == 0);
+	CHECK(map.Pending() == 0);
+}
+
+//------------------------------------------------------------------------------
+static void TestSet(){
+	BlockMap map;
+
+	map.Reset(20);
+	CHECK(map.Set(0));
+	CHECK(map.Set(19));
+	CHECK(!map.Set(20));
+	CHECK(map.Pending() == 18);
+	CHECK(map.Set(19));					// duplicate: no double count
+	CHECK(map.Pending() == 18);
+	CHECK(map.Has(0));
+	CHECK(map.Has(19));
+	CHECK(!map.Has(1));
+	CHECK(!map.Has(20));
+	for(uint16_t c=0; c<20; c++){ map.Set(c);}
+	CHECK(map.Pending() == 0);
+	CHECK(map.FirstMissing() == 20);
+}
+
+//------------------------------------------------------------------------------
+static void TestFirstMissing(){
+	BlockMap map;
+
+	map.Reset(100);
+	CHECK(map.FirstMissing() == 0);
+	for(uint16_t c=0; c<42; c++){ map.Set(c);}
+	CHECK(map.FirstMissing() == 42);
+	map.Set(43);
+	CHECK(map.FirstMissing() == 42);
+	map.Set(42);
+	CHECK(map.FirstMissing() == 44);
+}
+
+//------------------------------------------------------------------------------
+static void TestMissing(){
+	BlockMap map;
+	uint8_t buffer[4];
+
+	// 13 blocks: bytes 0 and 1 used, bits 13..15 of byte 1 past the end
+	map.Reset(13);
+	map.Missing(buffer, 0, 4);
+	CHECK(buffer[0] == 0xFF);
+	CHECK(buffer[1] == 0x1F);
+	CHECK(buffer[2] == 0x00);
+	CHECK(buffer[3] == 0x00);
+
+	map.Set(0); map.Set(7); map.Set(8); map.Set(12);
+	map.Missing(buffer, 0, 2);
+	CHECK(buffer[0] == 0x7E);
+	CHECK(buffer[1] == 0x0E);
+
+	// window with offset
+	map.Missing(buffer, 1, 1);
+	CHECK(buffer[0] == 0x0E);
+
+	// window past the end of the bitmap reads as nothing missing
+	map.Reset(BLOCKMAP_BLOCKS_MAX);
+	map.Missing(buffer, BLOCKMAP_SIZE - 2, 4);
+	CHECK(buffer[0] == 0xFF);
+	CHECK(buffer[1] == 0xFF);
+	CHECK(buffer[2] == 0x00);
+	CHECK(buffer[3] == 0x00);
+}
+
+//------------------------------------------------------------------------------
+int main(){
+	TestEmpty();
+	TestReset();
+	TestSet();
+	TestFirstMissing();
+	TestMissing();
+
+	if(failures){ printf("BlockMapTest: %d failure(s)\n", failures);}
+	else { printf("BlockMapTest: ok\n");}
+	return(failures);
+}
+
+//==============================================================================
@@ -0,0 +1,240 @@
+//==============================================================================
+// Host tests for the bus firmware update (FirmwareUpdate command handlers):
+// a controller broadcasts UPDATE_BEGIN / UPDATE_BLOCK to several nodes that
+// each lose some blocks, then uses UPDATE_STATUS to resend only the missing
+// ones before UPDATE_APPLY.
+// The flash array and the flash size register are mapped at their STM32
+// addresses (the slot symbols are set by the Makefile with --defsym); each
+// node keeps its own copy of slot B, swapped in around its calls.
+//==============================================================================
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "FirmwareUpdate.h"
+
+static int failures = 0;
+
+#define CHECK(x)	do{ if(!(x)){ printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #x); failures++;}}while(0)
+
+FLASH_TypeDef HostFlash;
+
+#define HOST_FLASH_SIZE		(64 * 1024)
+#define HOST_INFO_PAGE		0x1FFFF000UL	// holds the flash size register
+#define SLOT_B_REGION		(32 * 1024)		// slot B and its tag
+
+#define NODES				3
+#define IMAGE_SIZE			10000			// 313 blocks, the last one short
+#define ROUNDS_MAX			8
+
+//------------------------------------------------------------------------------
+struct Node{
+	FirmwareUpdate updater;
+	uint8_t flash[SLOT_B_REGION];
+	bool busy;
+};
+
+static Node nodes[NODES];
+static uint8_t image[IMAGE_SIZE];
+
+//------------------------------------------------------------------------------
+static bool MapFlash(){
+	void* flash = mmap((void*) FLASH_BASE, HOST_FLASH_SIZE, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+	void* info = mmap((void*) HOST_INFO_PAGE, 4096, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+	if((flash == MAP_FAILED)||(info == MAP_FAILED)){ return(false);}
+	DEVICE_FLASH_KB = 64;
+	return(true);
+}
+
+//------------------------------------------------------------------------------
+// erased flash (the host does not emulate page erase)
+static void ResetNodes(){
+	for(int n=0; n<NODES; n++){
+		nodes[n].updater = FirmwareUpdate();
+		memset(nodes[n].flash, 0xFF, sizeof(nodes[n].flash));
+		nodes[n].busy = false;
+	}
+}
+
+//------------------------------------------------------------------------------
+// one datagram to one node: | cmd | payload | -> reply payload
+static uint8_t Send(int n, uint8_t cmd, const uint8_t* request, uint8_t length, uint8_t* reply){
+	Node* node = &nodes[n];
+	uint8_t size = 0;
+
+	memcpy((void*) SLOT_B_START, node->flash, SLOT_B_REGION);
+	switch(cmd){
+		case 0x41: size = node->updater.OnBegin(request, length, node->busy, reply); break;
+		case 0x42: size = node->updater.OnBlock(request, length, node->busy, reply); break;
+		case 0x43: size = node->updater.OnStatus(request, length, reply); break;
+		case 0x44: size = node->updater.OnApply(reply); break;
+		default: break;
+	}
+	memcpy(node->flash, (const void*) SLOT_B_START, SLOT_B_REGION);
+	return(size);
+}
+
+//------------------------------------------------------------------------------
+static uint8_t Begin(int n, uint32_t size, uint32_t crc){
+	uint8_t request[8];
+	uint8_t reply[UPDATE_REPLY_MAX];
+
+	for(int b=0; b<4; b++){
+		request[b] = (uint8_t)(size >> (8 * b));
+		request[4 + b] = (uint8_t)(crc >> (8 * b));
+	}
+	CHECK(Send(n, 0x41, request, 8, reply) == 1);
+	return(reply[0]);
+}
+
+//------------------------------------------------------------------------------
+static uint8_t SendBlock(int n, uint16_t index){
+	uint8_t request[UPDATE_BLOCK_SIZE + 2];
+	uint8_t reply[UPDATE_REPLY_MAX];
+	uint32_t offset = (uint32_t) index * UPDATE_BLOCK_SIZE;
+	uint8_t size = UPDATE_BLOCK_SIZE;
+
+	if((IMAGE_SIZE - offset) < size){ size = (uint8_t)(IMAGE_SIZE - offset);}
+	request[0] = (uint8_t)(index & 0xFF);
+	request[1] = (uint8_t)(index >> 8);
+	memcpy(request + 2, image + offset, size);
+	CHECK(Send(n, 0x42, request, size + 2, reply) == 3);
+	return(reply[0]);
+}
+
+//------------------------------------------------------------------------------
+// reads every UPDATE_STATUS window of one node; sets "wanted" for its missing blocks
+static uint16_t Status(int n, bool* wanted, uint16_t blocks){
+	uint8_t reply[UPDATE_REPLY_MAX];
+	uint16_t pending = 0;
+
+	for(uint8_t offset = 0; (offset * 8) < blocks; offset += UPDATE_STATUS_WINDOW){
+		CHECK(Send(n, 0x43, &offset, 1, reply) == (6 + UPDATE_STATUS_WINDOW));
+		pending = reply[1] | (reply[2] << 8);
+		CHECK(reply[5] == offset);
+		for(int k=0; k<UPDATE_STATUS_WINDOW; k++){
+			for(int b=0; b<8; b++){
+				uint16_t index = (uint16_t)((offset + k) * 8 + b);
+				if((reply[6 + k] & (0x01 << b)) && (index < blocks)){ wanted[index] = true;}
+			}
+		}
+	}
+	return(pending);
+}
+
+//------------------------------------------------------------------------------
+static uint8_t Apply(int n){
+	uint8_t reply[UPDATE_REPLY_MAX];
+	CHECK(Send(n, 0x44, NULL, 0, reply) == 1);
+	return(reply[0]);
+}
+
+//------------------------------------------------------------------------------
+// node "n" misses block "index" of transmission "round" (a few percent each)
+static bool Lost(int n, uint16_t index, int round){
+	return((((index * 7) + (n * 13) + (round * 5)) % 11) == 0);
+}
+
+//------------------------------------------------------------------------------
+static void TestBroadcastRetransmit(){
+	const uint16_t blocks = (IMAGE_SIZE + UPDATE_BLOCK_SIZE - 1) / UPDATE_BLOCK_SIZE;
+	uint32_t crc = FirmwareUpdate::Crc32(image, IMAGE_SIZE);
+	bool wanted[blocks];
+	int round;
+
+	ResetNodes();
+	for(int n=0; n<NODES; n++){ CHECK(Begin(n, IMAGE_SIZE, crc) == fuReceiving);}
+
+	// the whole image once; node 1 is moving its digit for a while
+	for(uint16_t i=0; i<blocks; i++){
+		nodes[1].busy = ((i >= 40) && (i < 60));
+		for(int n=0; n<NODES; n++){
+			if(Lost(n, i, 0)){ continue;}
+			uint8_t state = SendBlock(n, i);
+			CHECK(state == (nodes[n].busy ? fuBusy : fuReceiving));
+		}
+	}
+	nodes[1].busy = false;
+
+	// not complete yet: APPLY must not verify
+	CHECK(Apply(0) == fuReceiving);
+
+	// STATUS from every node, then one broadcast of the blocks anyone misses
+	for(round = 1; round < ROUNDS_MAX; round++){
+		uint16_t pending = 0;
+		memset(wanted, 0, sizeof(wanted));
+		for(int n=0; n<NODES; n++){ pending += Status(n, wanted, blocks);}
+		if(pending == 0){ break;}
+
+		for(uint16_t i=0; i<blocks; i++){
+			if(!wanted[i]){ continue;}
+			for(int n=0; n<NODES; n++){
+				if(!Lost(n, i, round)){ SendBlock(n, i);}
+			}
+		}
+	}
+	CHECK(round > 1);
+	CHECK(round < ROUNDS_MAX);
+
+	for(int n=0; n<NODES; n++){
+		CHECK(nodes[n].updater.Pending() == 0);
+		CHECK(Apply(n) == fuVerified);
+		CHECK(memcmp(nodes[n].flash, image, IMAGE_SIZE) == 0);
+	}
+}
+
+//------------------------------------------------------------------------------
+static void TestBusyBegin(){
+	ResetNodes();
+	nodes[0].busy = true;
+	CHECK(Begin(0, IMAGE_SIZE, 0) == fuBusy);
+	CHECK(nodes[0].updater.State() == fuIdle);
+	nodes[0].busy = false;
+	CHECK(Begin(0, IMAGE_SIZE, 0) == fuReceiving);
+}
+
+//------------------------------------------------------------------------------
+static void TestBadImage(){
+	const uint16_t blocks = (IMAGE_SIZE + UPDATE_BLOCK_SIZE - 1) / UPDATE_BLOCK_SIZE;
+
+	ResetNodes();
+	CHECK(Begin(0, IMAGE_SIZE, FirmwareUpdate::Crc32(image, IMAGE_SIZE) ^ 1) == fuReceiving);
+	for(uint16_t i=0; i<blocks; i++){ SendBlock(0, i);}
+	CHECK(Apply(0) == fuFailed);
+
+	// too large for the slots
+	CHECK(Begin(0, SLOT_B_SIZE + 1, 0) == fuFailed);
+}
+
+//------------------------------------------------------------------------------
+static void TestNoSlot(){
+	ResetNodes();
+	DEVICE_FLASH_KB = 32;
+	CHECK(Begin(0, IMAGE_SIZE, 0) == fuUnsupported);
+	DEVICE_FLASH_KB = 64;
+}
+
+//------------------------------------------------------------------------------
+int main(){
+	if(!MapFlash()){
+		printf("FirmwareUpdateTest: cannot map the flash array\n");
+		return(1);
+	}
+	uint32_t seed = 12345;
+	for(int c=0; c<IMAGE_SIZE; c++){
+		seed = seed * 1103515245 + 12345;
+		image[c] = (uint8_t)(seed >> 16);
+	}
+
+	TestBroadcastRetransmit();
+	TestBusyBegin();
+	TestBadImage();
+	TestNoSlot();
+
+	if(failures){ printf("FirmwareUpdateTest: %d failure(s)\n", failures);}
+	else { printf("FirmwareUpdateTest: ok\n");}
+	return(failures);
+}
+
+//==============================================================================
@@ -0,0 +1,156 @@
+//==============================================================================
+// Host tests for FlipSequencer (digit move sequence) and FlipDisplayBank.
+//==============================================================================
+#include <stdio.h>
+#include "FlipSequencer.h"
+#include "FlipDisplayBank.h"
+
+static int failures = 0;
+
+#define CHECK(x)	do{ if(!(x)){ printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #x); failures++;}}while(0)
+
+#define MOVE_TIME_MAX	5000	// ms, far longer than any single move
+
+//------------------------------------------------------------------------------
+// Runs the sequence until idle; returns the number of digit moves made
+static int RunToIdle(FlipSequencer& seq){
+	int moves = 0;
+	for(int ms=0; (ms < MOVE_TIME_MAX) && seq.Busy(); ms++){
+		uint8_t events = seq.Tick();
+		if((events & SEQ_PHASE) && (seq.Phase() == RAMP_CLEAR)){ moves++;}
+	}
+	return(moves);
+}
+
+//------------------------------------------------------------------------------
+// Ticks the sequence until it starts the given move phase
+static void RunToPhase(FlipSequencer& seq, uint8_t phase){
+	for(int ms=0; ms < MOVE_TIME_MAX; ms++){
+		if((seq.Tick() & SEQ_PHASE) && (seq.Phase() == phase)){ return;}
+	}
+}
+
+//------------------------------------------------------------------------------
+static void TestShow(){
+	FlipSequencer seq;
+	seq.Delay = 30;
+
+	CHECK(seq.Show(conversion_table[1]) == fsStarted);
+	CHECK(seq.Busy());
+	CHECK(RunToIdle(seq) == 1);
+	CHECK(!seq.Busy());
+	CHECK(seq.Show(conversion_table[1]) == fsShown);
+}
+
+//------------------------------------------------------------------------------
+// A pattern asked for during a move is shown by a second move
+static void TestLatched(){
+	FlipSequencer seq;
+	seq.Delay = 30;
+
+	CHECK(seq.Show(conversion_table[1]) == fsStarted);
+	RunToPhase(seq, RAMP_H);
+	CHECK(seq.Show(conversion_table[2]) == fsPending);
+	CHECK(seq.Pattern() == conversion_table[2]);
+	CHECK(RunToIdle(seq) == 1);
+	CHECK(seq.Show(conversion_table[2]) == fsShown);
+}
+
+//------------------------------------------------------------------------------
+// Only the last of several patterns latched during a move is shown
+static void TestLastWins(){
+	FlipSequencer seq;
+	seq.Delay = 30;
+
+	CHECK(seq.Show(conversion_table[1]) == fsStarted);
+	RunToPhase(seq, RAMP_CLEAR);
+	CHECK(seq.Show(conversion_table[2]) == fsPending);
+	CHECK(seq.Show(conversion_table[3]) == fsPending);
+	CHECK(RunToIdle(seq) == 1);
+	CHECK(seq.Show(conversion_table[3]) == fsShown);
+}
+
+//------------------------------------------------------------------------------
+// Going back to the pattern on display during a move needs a second move
+static void TestLatchedBack(){
+	FlipSequencer seq;
+	seq.Delay = 30;
+
+	seq.Show(conversion_table[1]);
+	RunToIdle(seq);
+	CHECK(seq.Show(conversion_table[2]) == fsStarted);
+	RunToPhase(seq, RAMP_V);
+	CHECK(seq.Show(conversion_table[1]) == fsPending);
+	CHECK(RunToIdle(seq) == 1);
+	CHECK(seq.Show(conversion_table[1]) == fsShown);
+}
+
+//------------------------------------------------------------------------------
+// Without start-up delay the arrow move follows; a pattern latched then is
+// still shown
+static void TestLatchedArrow(){
+	FlipSequencer seq;
+
+	seq.Show(conversion_table[4]);
+	for(int ms=0; (ms < MOVE_TIME_MAX) && (seq.State() != fdArrow_Move); ms++){ seq.Tick();}
+	CHECK(seq.State() == fdArrow_Move);
+	CHECK(seq.Show(conversion_table[5]) == fsPending);
+	CHECK(RunToIdle(seq) == 1);
+	CHECK(seq.Show(conversion_table[5]) == fsShown);
+}
+
+//------------------------------------------------------------------------------
+class TestBank : public FlipDisplayBank{
+	public:
+		TestBank(uint8_t digits):FlipDisplayBank(NULL, digits){}
+		uint8_t Load(){ return(load);}
+		void Ppm(){ ProcessEvent();}
+};
+
+static uint8_t bank_updates;
+static void Bank_OnValueUpdate(uint8_t d){ bank_updates |= (0x01 << d);}
+
+//------------------------------------------------------------------------------
+// Two digit moves do not fit in one digit budget: they run one after the other
+static void TestBankBudget(){
+	TestBank bank(2);
+	NMESSAGE msg;
+	uint8_t load_max = 0;
+	int ms;
+
+	for(int d=0; d<2; d++){ bank.Channel(d)->Delay = 30;}
+	bank.Budget = BANK_LOAD_DIGIT;
+	bank.OnValueUpdate = Bank_OnValueUpdate;
+	bank_updates = 0;
+
+	bank.SetValue(0, 7);
+	bank.SetValue(1, 8);
+	for(ms=0; (ms < 2 * MOVE_TIME_MAX) && bank.Busy(); ms++){
+		msg.message = NM_TIMETICK;
+		bank.Notify(&msg);
+		for(int t=0; t<10; t++){ bank.Ppm();}
+		if(bank.Load() > load_max){ load_max = bank.Load();}
+	}
+	CHECK(!bank.Busy());
+	CHECK(load_max == BANK_LOAD_DIGIT);
+	CHECK(bank_updates == 0x03);
+	CHECK(bank.GetPattern(0) == conversion_table[7]);
+	CHECK(bank.GetPattern(1) == conversion_table[8]);
+	CHECK(bank.Load() == 0);
+}
+
+//------------------------------------------------------------------------------
+int main(){
+	TestShow();
+	TestLatched();
+	TestLastWins();
+	TestLatchedBack();
+	TestLatchedArrow();
+	TestBankBudget();
+
+	if(failures){ printf("FlipSequencerTest: %d failure(s)\n", failures);}
+	else { printf("FlipSequencerTest: ok\n");}
+	return(failures);
+}
+
+//==============================================================================
@@ -0,0 +1,38 @@
+//==============================================================================
+// Host stand-in for the EDROS NHardwareTimer (timer interrupt and message
+// dispatch are driven by the test itself).
+//==============================================================================
+#ifndef NHardwareTimer_H
+    #define NHardwareTimer_H
+
+	#include <stdint.h>
+	#include <stddef.h>
+
+	typedef struct { volatile uint32_t CR1; } TIM_TypeDef;
+	typedef struct { volatile uint32_t BSRR, BRR; } GPIO_TypeDef;
+
+	enum { NM_NULL, NM_TIMETICK };
+	struct NMESSAGE { uint32_t message; };
+
+	enum htPriority { htPriorityLevel0, htPriorityLevel1, htPriorityLevel2, htPriorityLevel3 };
+
+	class NComponent{
+		public:
+			uint32_t Tag;
+			virtual void Notify(NMESSAGE*){}
+			virtual ~NComponent(){}
+	};
+
+	class NHardwareTimer : public NComponent{
+		protected:
+			virtual bool ProcessEvent(){ return(true);}
+		public:
+			NHardwareTimer(TIM_TypeDef*){ IrqPriority = htPriorityLevel0; Running = false;}
+			void Start(uint32_t){ Running = true;}
+			void Stop(){ Running = false;}
+			htPriority IrqPriority;
+			bool Running;
+	};
+
+#endif
+//==============================================================================
@@ -0,0 +1,18 @@
+//==============================================================================
+// Host stand-in for the EDROS NTinyOutput (the level is only stored).
+//==============================================================================
+#ifndef NTinyOutput_H
+    #define NTinyOutput_H
+
+	#include "NHardwareTimer.h"
+
+	enum toLevels { toLow, toHigh };
+
+	class NTinyOutput{
+		public:
+			NTinyOutput(){ Level = toLow;}
+			toLevels Level;
+	};
+
+#endif
+//==============================================================================
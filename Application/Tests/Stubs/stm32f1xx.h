@@ -0,0 +1,37 @@
+//==============================================================================
+// Host stand-in for the CMSIS device header: the flash controller registers
+// are a plain structure, with the write-1-to-clear status register emulated
+// (FirmwareUpdateTest maps the flash array itself).
+//==============================================================================
+#ifndef STM32F1XX_H
+    #define STM32F1XX_H
+
+	#include <stdint.h>
+
+	struct HostFlashSR{
+		uint32_t value;
+		HostFlashSR& operator=(uint32_t bits){ value &= ~bits; return(*this);}
+		operator uint32_t() const { return(value);}
+	};
+
+	typedef struct { uint32_t ACR, KEYR, OPTKEYR; HostFlashSR SR; uint32_t CR, AR, RESERVED, OBR, WRPR; } FLASH_TypeDef;
+
+	extern FLASH_TypeDef HostFlash;
+
+	#define FLASH					(&HostFlash)
+	#define FLASH_BASE				0x08000000UL
+
+	#define FLASH_SR_BSY			0x01
+	#define FLASH_SR_PGERR			0x04
+	#define FLASH_SR_WRPRTERR		0x10
+	#define FLASH_SR_EOP			0x20
+	#define FLASH_CR_PG				0x01
+	#define FLASH_CR_PER			0x02
+	#define FLASH_CR_STRT			0x40
+	#define FLASH_CR_LOCK			0x80
+
+	static inline void __disable_irq(){}
+	static inline void NVIC_SystemReset(){}
+
+#endif
+//==============================================================================
@@ -0,0 +1,334 @@
+#!/usr/bin/env python3
+#==============================================================================
+# DGT-02 benchmark run: plays a scripted match on one node over the PROSA bus
+# and writes what the node reports (BENCHMARK probes, memory budget, MEMORY
+# high-water marks, score checksum) plus the ELF section sizes to a text file,
+# one "key value" per line, so two runs can be compared with diff.
+#
+# The bus is either a serial port (RS-485 adapter, needs pyserial) or a TCP
+# socket, e.g. the USART1 terminal of the Renode machine in DGT02.resc:
+#
+#   renode -e '$elf=@Debug/Application.elf; include @Tests/DGT02.resc'
+#   python3 Tests/bench_run.py --tcp localhost:3456 --src 0x.. --elf \
+#           Debug/Application.elf -o bench.txt
+#
+# Probe cycle counts are only filled in by the Benchmark build configuration
+# (BENCHMARK_ENABLED, see Benchmark.h); under Renode they count emulated, not
+# real, cycles. The MEMORY main / interrupt split and heap items are only
+# filled in by the Diagnostics configuration (DIAGNOSTICS_ENABLED, see
+# MemoryStats.h); the other builds report them as 0.
+#
+# Frame: | dst | src | len | cmd | payload (len bytes) | crc | crc |
+# The CRC variant and the byte order of 4-byte fields come from NDatagram
+# (M3_Prosa), which is not in this tree: they default to CRC-16/MODBUS, low
+# byte first, and little endian (Cortex-M3), and can be changed with --crc and
+# --u32. A reply with a bad CRC is checked against every known variant and
+# the error names the one that fits; a memory budget that only makes sense in
+# the other byte order stops the run the same way.
+#
+# --selftest runs the whole script against a fake node on a local socket
+# that answers with the reply layouts of Application.cpp (no firmware).
+#==============================================================================
+import argparse
+import socket
+import struct
+import subprocess
+import sys
+import threading
+import time
+
+#------------------------------------------------------------------------------
+# Application.h / TennisScore.h
+CMD_BENCHMARK  = 0x48
+CMD_SCOREEVENT = 0x4C
+CMD_SCORESUM   = 0x4D
+CMD_MEMORY     = 0x4E
+
+EV_POINT_P1   = 0x01
+EV_POINT_P2   = 0x02
+EV_NEW_MATCH  = 0x06
+
+BENCH_PROBES  = ["ppm_tick", "bus_packet"]      # Benchmark.h, BENCH_* order
+BENCH_FIELDS  = ["min", "avg", "max", "count", "load"]
+BUDGET_FIELDS = ["flash_used", "flash_size", "ram_used", "ram_size"]
+MEM_FIELDS    = ["stack_size", "stack_peak", "main", "interrupt", "heap_used",
+                 "heap_peak", "heap_blocks", "heap_extent", "fragmentation"]
+
+# Default match: a love game for each player, then a deuce game won by
+# player 1 (covers advantage and deuce again), then a point into game 4.
+SEQUENCE = [EV_NEW_MATCH] + \
+           [EV_POINT_P1] * 4 + \
+           [EV_POINT_P2] * 4 + \
+           [EV_POINT_P1, EV_POINT_P2] * 3 + [EV_POINT_P1, EV_POINT_P2] + \
+           [EV_POINT_P1] * 2 + \
+           [EV_POINT_P2]
+
+#------------------------------------------------------------------------------
+# CRC-16 variants: (reflected polynomial or plain polynomial, init, reflected)
+CRC_VARIANTS = {
+    "modbus":      (0xA001, 0xFFFF, True),
+    "kermit":      (0x8408, 0x0000, True),
+    "ccitt-false": (0x1021, 0xFFFF, False),
+    "xmodem":      (0x1021, 0x0000, False),
+}
+# check values over b"123456789" (catalogue of parametrised CRC algorithms)
+CRC_CHECK = {"modbus": 0x4B37, "kermit": 0x2189,
+             "ccitt-false": 0x29B1, "xmodem": 0x31C3}
+
+def crc16(data, variant):
+    poly, crc, reflected = CRC_VARIANTS[variant]
+    for b in data:
+        if reflected:
+            crc ^= b
+            for _ in range(8):
+                crc = (crc >> 1) ^ poly if crc & 1 else crc >> 1
+        else:
+            crc ^= b << 8
+            for _ in range(8):
+                crc = ((crc << 1) ^ poly if crc & 0x8000 else crc << 1) & 0xFFFF
+    return crc
+
+for _name, _check in CRC_CHECK.items():
+    assert crc16(b"123456789", _name) == _check, _name
+
+# CRC variant and byte order that match a received frame, for the error text
+def identify_crc(data, low, high):
+    found = []
+    for name in CRC_VARIANTS:
+        crc = crc16(data, name)
+        if crc == (low | (high << 8)):
+            found.append("%s, low byte first" % name)
+        if crc == ((low << 8) | high):
+            found.append("%s, high byte first" % name)
+    return ", ".join(found) if found else "no known CRC-16"
+
+#------------------------------------------------------------------------------
+class Bus:
+    def __init__(self, args):
+        if args.tcp:
+            host, port = args.tcp.rsplit(":", 1)
+            self.sock = socket.create_connection((host, int(port)))
+            self.sock.settimeout(args.timeout)
+            self.port = None
+        else:
+            import serial
+            self.port = serial.Serial(args.port, args.baud, timeout=args.timeout)
+            self.sock = None
+        self.src = args.src
+        self.timeout = args.timeout
+        self.crc = args.crc
+
+    def read(self, size):
+        data = b""
+        while len(data) < size:
+            if self.sock:
+                try:
+                    chunk = self.sock.recv(size - len(data))
+                except socket.timeout:
+                    chunk = b""
+            else:
+                chunk = self.port.read(size - len(data))
+            if not chunk:
+                raise TimeoutError("no reply")
+            data += chunk
+        return data
+
+    def write(self, data):
+        if self.sock:
+            self.sock.sendall(data)
+        else:
+            self.port.write(data)
+
+    def flush_input(self):
+        if self.port:
+            self.port.reset_input_buffer()
+            return
+        self.sock.setblocking(False)
+        try:
+            while self.sock.recv(256):
+                pass
+        except (BlockingIOError, socket.error):
+            pass
+        self.sock.settimeout(self.timeout)
+
+    # sends one datagram and returns the payload of the node's reply
+    def request(self, dst, cmd, payload=b""):
+        frame = bytes([dst, self.src, len(payload), cmd]) + bytes(payload)
+        crc = crc16(frame, self.crc)
+        self.flush_input()
+        self.write(frame + bytes([crc & 0xFF, crc >> 8]))
+        head = self.read(4)
+        body = self.read(head[2] + 2)
+        data = head + body[:-2]
+        if crc16(data, self.crc) != (body[-2] | (body[-1] << 8)):
+            raise IOError("bad crc in reply to 0x%02X (%s) matches: %s" %
+                          (cmd, self.crc, identify_crc(data, body[-2], body[-1])))
+        if head[3] != cmd:
+            raise IOError("reply 0x%02X to 0x%02X" % (head[3], cmd))
+        return body[:-2]
+
+#------------------------------------------------------------------------------
+def elf_sizes(elf, size_tool):
+    out = subprocess.run([size_tool, "-A", elf], check=True,
+                         capture_output=True, text=True).stdout
+    result = []
+    for line in out.splitlines():
+        fields = line.split()
+        if len(fields) == 3 and fields[0].startswith(".") and fields[1].isdigit():
+            result.append(("elf%s" % fields[0], int(fields[1])))
+    return result
+
+#------------------------------------------------------------------------------
+def wait_ready(bus, node, wait):
+    # display and score commands are enabled once the node's power-on
+    # calibration wave is over
+    limit = time.time() + wait
+    while True:
+        try:
+            return bus.request(node, CMD_SCORESUM)
+        except TimeoutError:
+            if time.time() > limit:
+                raise
+
+#------------------------------------------------------------------------------
+def run(bus, node, interval, report, u32="<"):
+    # start from clean probes
+    bus.request(node, CMD_BENCHMARK, [0xFE])
+
+    seq = 0
+    for event in SEQUENCE:
+        reply = bus.request(node, CMD_SCOREEVENT, [seq, event])
+        seq = (seq + 1) & 0xFF
+        time.sleep(interval)                    # let the digit finish moving
+    report.append(("score.events", len(SEQUENCE)))
+    report.append(("score.seq", reply[1]))
+    report.append(("score.checksum", "0x%04X" % (reply[2] | (reply[3] << 8))))
+    report.append(("score.diverged", reply[4]))
+
+    for probe, name in enumerate(BENCH_PROBES):
+        reply = bus.request(node, CMD_BENCHMARK, [probe])
+        values = struct.unpack(u32 + "5I", reply[1:21])
+        for field, value in zip(BENCH_FIELDS, values):
+            report.append(("bench.%s.%s" % (name, field), value))
+
+    reply = bus.request(node, CMD_BENCHMARK, [0xFF])
+    budget = struct.unpack(u32 + "4I", reply[1:17])
+    other = struct.unpack(("<" if u32 == ">" else ">") + "4I", reply[1:17])
+    # slot A is 30K: a flash size that only fits in the other byte
+    # order means --u32 is wrong
+    if not 1024 <= budget[1] <= 0x10000:
+        hint = " (fits with the other --u32)" if 1024 <= other[1] <= 0x10000 else ""
+        raise IOError("memory budget flash size %d%s" % (budget[1], hint))
+    for field, value in zip(BUDGET_FIELDS, budget):
+        report.append(("budget.%s" % field, value))
+
+    reply = bus.request(node, CMD_MEMORY)
+    values = struct.unpack("<%dH" % len(MEM_FIELDS), reply[1:1 + 2 * len(MEM_FIELDS)])
+    for field, value in zip(MEM_FIELDS, values):
+        report.append(("memory.%s" % field, value))
+
+#------------------------------------------------------------------------------
+# Fake node for --selftest: the reply layouts of Application.cpp, made-up values
+class FakeNode(threading.Thread):
+    def __init__(self, node, crc, u32):
+        super().__init__(daemon=True)
+        self.server = socket.socket()
+        self.server.bind(("localhost", 0))
+        self.server.listen(1)
+        self.port = self.server.getsockname()[1]
+        self.node, self.crc, self.u32 = node, crc, u32
+        self.seq, self.diverged = 0xFF, 0
+
+    def reply(self, head, payload):
+        cmd = head[3]
+        out = bytes([self.node])
+        if cmd == CMD_SCOREEVENT:
+            seq, event = payload
+            if event != EV_NEW_MATCH and seq != (self.seq + 1) & 0xFF:
+                self.diverged = 1
+            self.seq = seq
+        if cmd == CMD_SCOREEVENT or cmd == CMD_SCORESUM:
+            out += bytes([self.seq, 0x34, 0x12, self.diverged])
+        elif cmd == CMD_BENCHMARK:
+            # answered with the probe, not the node address
+            probe = payload[0] if payload else 0xFF
+            out = bytes([probe])
+            if probe < len(BENCH_PROBES):
+                out += struct.pack(self.u32 + "5I", 100, 150, 200, 12, 7)
+            elif probe == 0xFF:
+                out += struct.pack(self.u32 + "4I", 20000, 30720, 8000, 10240)
+        elif cmd == CMD_MEMORY:
+            out += struct.pack("<%dH" % len(MEM_FIELDS), *range(len(MEM_FIELDS)))
+        frame = bytes([head[1], head[0], len(out), cmd]) + out
+        crc = crc16(frame, self.crc)
+        return frame + bytes([crc & 0xFF, crc >> 8])
+
+    def run(self):
+        conn, _ = self.server.accept()
+        while True:
+            head = conn.recv(4, socket.MSG_WAITALL)
+            if len(head) < 4:
+                return
+            body = conn.recv(head[2] + 2, socket.MSG_WAITALL)
+            conn.sendall(self.reply(head, body[:-2]))
+
+#------------------------------------------------------------------------------
+def main():
+    parser = argparse.ArgumentParser(description="DGT-02 benchmark run")
+    link = parser.add_mutually_exclusive_group()
+    link.add_argument("--port", help="serial port of the bus adapter")
+    link.add_argument("--tcp", help="host:port of a bus terminal (Renode)")
+    link.add_argument("--selftest", action="store_true",
+                      help="run against a fake node, no firmware needed")
+    parser.add_argument("--baud", type=int, help="bus standard rate (--port only)")
+    parser.add_argument("--src", type=lambda x: int(x, 0),
+                        help="source address of this controller (PROSA_ADDR_*)")
+    parser.add_argument("--node", type=lambda x: int(x, 0), default=0x02,
+                        help="node address (default PLAY1_UNITS)")
+    parser.add_argument("--interval", type=float, default=2.0,
+                        help="seconds between score events")
+    parser.add_argument("--timeout", type=float, default=1.0)
+    parser.add_argument("--wait", type=float, default=30.0,
+                        help="seconds to wait for the node's power-on calibration")
+    parser.add_argument("--crc", choices=sorted(CRC_VARIANTS), default="modbus",
+                        help="PROSA frame CRC (default modbus)")
+    parser.add_argument("--u32", choices=["little", "big"], default="little",
+                        help="byte order of 4-byte reply fields")
+    parser.add_argument("--elf", help="firmware ELF, for the section sizes")
+    parser.add_argument("--size", default="arm-none-eabi-size")
+    parser.add_argument("-o", "--output")
+    args = parser.parse_args()
+    u32 = "<" if args.u32 == "little" else ">"
+
+    if args.selftest:
+        fake = FakeNode(args.node, args.crc, u32)
+        fake.start()
+        args.tcp = "localhost:%d" % fake.port
+        args.interval = 0
+        if args.src is None:
+            args.src = 0x10
+    else:
+        if not (args.port or args.tcp):
+            parser.error("one of --port, --tcp or --selftest is needed")
+        if args.src is None or args.output is None:
+            parser.error("--src and -o are needed")
+    if args.port and not args.baud:
+        parser.error("--port needs --baud")
+
+    report = [("node", "0x%02X" % args.node),
+              ("frame.crc", args.crc), ("frame.u32", args.u32)]
+    if args.elf:
+        report += elf_sizes(args.elf, args.size)
+    bus = Bus(args)
+    wait_ready(bus, args.node, args.wait)
+    run(bus, args.node, args.interval, report, u32)
+
+    out = open(args.output, "w") if args.output else sys.stdout
+    for key, value in report:
+        out.write("%s %s\n" % (key, value))
+    if args.output:
+        out.close()
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main())